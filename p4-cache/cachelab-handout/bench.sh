@@ -0,0 +1,132 @@
+#!/bin/bash
+#
+# bench.sh - Time csim against an earlier revision of itself.
+#
+# Builds csim of git revision <rev> (default: the first commit, the
+# original simulator) in a temporary directory, then runs it and the
+# csim of this directory, or of the -c revision, over the shipped
+# long.trace concatenated <copies> times. Every row prints the best of
+# <runs> wall times of both and checks that their summaries agree. The
+# rows with flags and the reader rows need a csim that has those flags.
+# -t benchmarks a trace of your own instead, e.g. one whose footprint
+# outgrows the host caches.
+#
+#   linux> make bench
+#   linux> ./bench.sh -b HEAD~2 -c HEAD~1 -n 50 -r 5
+#
+usage() {
+    echo "Usage: $0 [-h] [-b <rev>] [-c <rev>] [-n <copies>] [-r <runs>] [-t <file>]"
+    echo "  -b <rev>     Baseline git revision (default: the first commit)."
+    echo "  -c <rev>     Candidate git revision (default: csim of this directory)."
+    echo "  -n <copies>  Copies of the trace to benchmark (default 20 of long.trace, else 1)."
+    echo "  -r <runs>    Runs per measurement, the best is kept (default 3)."
+    echo "  -t <file>    Lackey text trace to benchmark instead of traces/long.trace."
+}
+
+cd "$(dirname "$0")" || exit 1
+base=$(git rev-list --max-parents=0 HEAD 2>/dev/null | tail -1)
+cand=
+copies=
+runs=3
+src=traces/long.trace
+while getopts "hb:c:n:r:t:" opt; do
+    case $opt in
+    h) usage; exit 0 ;;
+    b) base=$OPTARG ;;
+    c) cand=$OPTARG ;;
+    n) copies=$OPTARG ;;
+    r) runs=$OPTARG ;;
+    t) src=$OPTARG ;;
+    *) usage; exit 1 ;;
+    esac
+done
+if [ -z "$copies" ]; then
+    copies=1
+    [ "$src" = traces/long.trace ] && copies=20
+fi
+make -s csim traceconv >/dev/null || exit 1
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+# Build csim of git revision $1 in $tmp/$2 from its own sources and Makefile
+build_rev() {
+    if [ -z "$1" ] || ! git rev-parse -q --verify "$1^{commit}" >/dev/null; then
+        echo "$0: bad revision $1" >&2
+        return 1
+    fi
+    mkdir "$tmp/$2"
+    git -C "$(git rev-parse --show-toplevel)" archive "$1:$(git rev-parse --show-prefix)" \
+        | tar -x -C "$tmp/$2" || return 1
+    rm -f "$tmp/$2/csim" "$tmp/$2"/*.o "$tmp/$2"/*.a # may be tracked, never trust them.
+    make -s -C "$tmp/$2" csim >/dev/null 2>&1 || { echo "$0: cannot build csim of $1" >&2; return 1; }
+}
+
+# Best wall time of $runs runs of the command, its output left in $tmp/out
+best() {
+    local t min=
+    for ((k = 0; k < runs; k++)); do
+        { t=$( { TIMEFORMAT=%R; time "$@" > "$tmp/out"; } 2>&1 ); } || { echo failed; return 1; }
+        if [ -z "$min" ] || awk "BEGIN { exit !($t < $min) }"; then
+            min=$t
+        fi
+    done
+    echo "$min"
+}
+
+build_rev "$base" base || exit 1
+basecsim=$tmp/base/csim
+newcsim=./csim
+newname="this directory"
+if [ -n "$cand" ]; then
+    build_rev "$cand" cand || exit 1
+    newcsim=$tmp/cand/csim
+    newname="$(git rev-parse --short "$cand") $(git log -1 --format=%s "$cand")"
+fi
+
+trace=$tmp/bench.trace
+for ((i = 0; i < copies; i++)); do
+    cat "$src" || exit 1
+done > "$trace"
+./traceconv -t "$trace" -o "$trace.bin" >/dev/null || exit 1
+
+echo "trace: $copies x $src, $(wc -l < "$trace") records"
+echo "base: $(git rev-parse --short "$base") $(git log -1 --format=%s "$base")"
+echo "csim: $newname"
+printf "%-28s %10s %10s %8s\n" "configuration" "base (s)" "csim (s)" "speedup"
+fail=0
+# s E b [csim flags]
+while read -r s E b flags; do
+    tb=$(best "$basecsim" -s "$s" -E "$E" -b "$b" -t "$trace") || fail=1
+    sb=$(grep '^hits:' "$tmp/out")
+    # shellcheck disable=SC2086
+    tn=$(best "$newcsim" -s "$s" -E "$E" -b "$b" $flags -t "$trace") || fail=1
+    sn=$(grep '^hits:' "$tmp/out")
+    if [ "$sb" != "$sn" ]; then
+        echo "MISMATCH -s $s -E $E -b $b $flags: $sb vs $sn" >&2
+        fail=1
+    fi
+    speedup=-
+    if [ "$tb" != failed ] && [ "$tn" != failed ]; then
+        speedup=$(awk "BEGIN { printf \"%.2fx\", $tb / $tn }")
+    fi
+    printf "%-28s %10s %10s %8s\n" "-s $s -E $E -b $b $flags" "$tb" "$tn" "$speedup"
+done <<EOF
+5 1 5
+1 1 1
+4 2 4
+6 8 6
+4 16 4
+2 64 6
+1 128 6
+14 16 6
+14 16 6 -j 4
+20 8 6
+EOF
+
+printf "\n%-28s %10s\n" "reader, -s 5 -E 1 -b 5" "csim (s)"
+for kind in stdio mmap bin; do
+    t=$trace
+    [ "$kind" = bin ] && t=$trace.bin
+    printf "%-28s %10s\n" "-T $kind" "$(best "$newcsim" -s 5 -E 1 -b 5 -T "$kind" -t "$t")"
+done
+exit $fail
@@ -14,12 +14,12 @@ int func_counter = 0;
  * printSummary - Summarize the cache simulation statistics. Student cache simulators
  *                must call this function in order to be properly autograded. 
  */
-void printSummary(int hits, int misses, int evictions)
+void printSummary(unsigned long hits, unsigned long misses, unsigned long evictions)
 {
-    printf("hits:%d misses:%d evictions:%d\n", hits, misses, evictions);
+    printf("hits:%lu misses:%lu evictions:%lu\n", hits, misses, evictions);
     FILE* output_fp = fopen(".csim_results", "w");
     assert(output_fp);
-    fprintf(output_fp, "%d %d %d\n", hits, misses, evictions);
+    fprintf(output_fp, "%lu %lu %lu\n", hits, misses, evictions);
     fclose(output_fp);
 }
 
@@ -2,188 +2,188 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <string.h>
-#include <ctype.h>
 #include "cachelab.h"
-
-#define LINE_LENGTH  20
-#define LRU_INIT_NUM 9999
-
-typedef unsigned cache_opt_res;
-/**
- * NOTE: 
- * I: nop
- * L: miss; hit; miss eviction;
- * S: miss; hit; miss eviction;
- * M: miss, hit; miss eviction; hit, hit
- */
-
-/* cache operation result type */
-cache_opt_res    HIT         = 0x01;
-cache_opt_res    MISS        = 0x10;
-cache_opt_res    EVICTION    = 0x100;
-    
-/* cache line struct */
-typedef struct cache_line_st{
-    int valid; // valid field
-    int tag;   // tag field
-    int block; // block field
-    int lrunum;
-} cache_line;
-
-/* cache set struct */
-typedef struct cache_set_st {
-    cache_line *cls;
-} cache_set;
-
-/* simulator cache statistics info struct */
-typedef struct cache_stats_st {
-    int hits;
-    int misses;
-    int evictions;
-} cache_stats;
-
-/* simulator cache struct */
-typedef struct simulator_cache_st {
-    int setcnt;
-    int linecnt;
-    int blockcnt;
-
-    int s, E, b;
-
-    char *tracefile;
-    cache_set *sets;
-    cache_stats cs;
-
-    int verbose;
-    int setmask;
-} simulator_cache;
-
-/* cache operation agrs struct */
-typedef struct {
-    char inst; // if 'I', then it's instruction operation, else data operation.
-    char opttype;
-    unsigned int addr;
-    int size;
-} cache_opt ;
-
-/******************** custome function declaration ******************************************/
-/* Print help options */
-void print_help_options();
-
-/* Parse simulator cache args */
-void parse_cache_args(int argc, char *argv[], simulator_cache *sc);
-
-/* Handle cache operations and record statistics */
-void handle_cache_stuff(simulator_cache *sc);
-
-/* Init simulator cache */
-void init_cache_matrix(simulator_cache *sc);
-
-/* Do base cache opt */
-void do_base_opt(simulator_cache *sc, cache_opt co, cache_opt_res *optres);
-
-/* Do normal cache opeartion */
-void do_cache_opt(simulator_cache *sc, cache_opt co);
-
-/* Do load data task */
-void do_load_data(simulator_cache *sc, cache_opt co);
-
-/* Do store data task */
-void do_store_data(simulator_cache *sc, cache_opt co);
-
-/* Do modify data task */
-void do_modify_data(simulator_cache *sc, cache_opt co);
-
-/* update cache data struct */
-int update_cache(simulator_cache *sc, int setno, int tag);
-
-/* Search the specific cache line index according LRU */
-int search_lru_cache_line(simulator_cache *sc, int setno);
-
-/* Free simulator cache memory */
-void free_cache(simulator_cache *sc);
-
-/* Trim white space for string */
-char *trim_white_space(char *str);
-
-/* Print cache opt result info */
-void print_verbose(simulator_cache *sc, cache_opt co, cache_opt_res optres, int flag);
-
-/******************** custome function declaration end ******************************************/
-
-// returns a pointer to a substring of the original string.
-// the return string can not be free.
-char *trim_white_space(char *str)
-{
-  char *end;
-
-  // Trim leading space
-  while(isspace((unsigned char)*str)) str++;
-
-  if(*str == 0)  // All spaces?
-    return str;
-
-  // Trim trailing space
-  end = str + strlen(str) - 1;
-  while(end > str && isspace((unsigned char)*end)) end--;
-
-  // Write new null terminator character
-  end[1] = '\0';
-
-  return str;
-}
+#include "csim_cli.h"
 
 /* Print help options */
 void print_help_options() 
 {
-    printf("Usage: ./csim [-hv] -s <num> -E <num> -b <num> -t <file>\n");
+    printf("Usage: ./csim [-hvacd] [-j <num>] [-i <num>] [-p <policy>] [-w <mode>] [-P <prefetcher>] [-S <rate>] [-m <num>] [-r <file> [-L <num>]] [-H <levels>] -s <num> -E <num> -b <num> -t <file>\n");
     printf("Options:\n");
     printf("  -h         Print this help message.\n");
     printf("  -v         Optional verbose flag.\n");
+    printf("  -a         Report every associativity 1..E in one pass.\n");
+    printf("  -c         Classify misses as compulsory, capacity or conflict.\n");
+    printf("  -d         Print reuse and time distance histograms, LRU misses per size.\n");
     printf("  -s <num>   Number of set index bits.\n");
     printf("  -E <num>   Number of lines per set.\n");
     printf("  -b <num>   Number of block offset bits.\n");
-    printf("  -t <file>  Trace file.\n");
+    printf("  -t <file>  Trace file, - for standard input; pipes and FIFOs are streamed.\n");
+    printf("  -T <kind>  Trace reader: mmap (default), stdio or bin.\n");
+    printf("  -i <num>   Print hits, misses, evictions and miss rate of every <num>\n");
+    printf("             data accesses, a modify being two as in the summary, as\n");
+    printf("             CSV, to stdout or :file.\n");
+    printf("  -j <num>   Simulate on <num> set-sharded worker threads.\n");
+    printf("  -p <name>  Replacement policy: lru (default), fifo, random[:seed],\n");
+    printf("             plru (tree, E a power of 2 <= %d), bitplru, srrip,\n", PLRU_MAX_WAYS);
+    printf("             brrip[:seed] or lfu.\n");
+    printf("  -w <mode>  Write handling: wb (write-back, default) or wt (write-through),\n");
+    printf("             then :wa (write-allocate, default) or :nwa; prints write stats.\n");
+    printf("  -P <kind>  L1 prefetcher next, stream or stride (per PC), optionally\n");
+    printf("             :degree[:distance], up to %d and %d blocks.\n", PF_MAX_DEGREE, PF_MAX_DISTANCE);
+    printf("  -S <rate>  Sampled LRU miss ratio curve at rate (0, 1], optionally\n");
+    printf("             :blocks to cap the tracked blocks (default %d).\n", SHARDS_SMAX);
+    printf("  -m <num>   Print the <num> instructions (lackey I records) with the most\n");
+    printf("             misses, as symbols of :binary[+load base] if given; valgrind\n");
+    printf("             loads a PIE binary such as tracegen at 0x108000.\n");
+    printf("  -r <file>  Per region statistics, eviction pairs and set aliasing for\n");
+    printf("             a map of \"name base length\" lines, e.g. tracegen's .regions.\n");
+    printf("  -L <num>   With -r, rank padded layouts of the most conflicting regions\n");
+    printf("             by re-simulating, print the best <num>.\n");
+    printf("  -H <list>  Lower cache levels below the -s/-E/-b L1, comma separated\n");
+    printf("             s:E:b[:incl|excl|nine][:policy], relation to the levels above.\n");
     printf("\n");
     printf("Examples:\n");
     printf("  linux>  ./csim -s 4 -E 1 -b 4 -t traces/yi.trace\n");
     printf("  linux>  ./csim -v -s 8 -E 2 -b 4 -t traces/yi.trace\n");
+    printf("  linux>  ./csim -a -s 4 -E 16 -b 4 -t traces/long.trace\n");
+    printf("  linux>  valgrind --tool=lackey --trace-mem=yes --log-fd=1 ls | ./csim -s 4 -E 1 -b 4 -t -\n");
+    printf("  linux>  ./csim -p plru -s 4 -E 8 -b 4 -t traces/long.trace\n");
+    printf("  linux>  ./csim -c -s 5 -E 1 -b 5 -t traces/trans.trace\n");
+    printf("  linux>  ./csim -d -s 5 -E 1 -b 5 -t traces/long.trace\n");
+    printf("  linux>  ./csim -i 10000:long.csv -s 5 -E 1 -b 5 -t traces/long.trace\n");
+    printf("  linux>  ./csim -S 0.01:4096 -s 5 -E 1 -b 5 -t traces/long.trace\n");
+    printf("  linux>  ./csim -w wt:nwa -s 5 -E 1 -b 5 -t traces/long.trace\n");
+    printf("  linux>  ./csim -P stream:2:4 -s 5 -E 2 -b 5 -t traces/long.trace\n");
+    printf("  linux>  valgrind --tool=lackey --trace-mem=yes --log-fd=1 ./tracegen -M 32 -N 32 -F 0 \\\n");
+    printf("              | ./csim -m 5:./tracegen+0x108000 -s 5 -E 1 -b 5 -t -\n");
+    printf("  linux>  ./csim -r .regions -s 5 -E 1 -b 5 -t traces/trans.trace\n");
+    printf("  linux>  ./csim -r .regions -L 5 -s 5 -E 1 -b 5 -t trans.trace\n");
+    printf("  linux>  ./csim -s 5 -E 1 -b 5 -H 7:4:5:incl,9:8:6:nine -t traces/long.trace\n");
 }
 
 /* Parse simulator cache args */
-void parse_cache_args(int argc, char *argv[], simulator_cache *sc)
+void parse_cache_args(int argc, char *argv[], csim_cli *cli)
 {
+    simulator_cache *sc = &cli->sc;
     extern char *optarg;
     extern int optind, opterr, optopt;
 
     char opt;
     int argcnt = 0;
-    while ((opt = getopt(argc, argv, "hvs:E:b:t:")) != -1) {
+    int kind;
+    csim_config cfg = {0};
+    char err[256];
+    int classify = 0;
+    int reuse = 0;
+    char *sampling = NULL;
+    char *regionfile = NULL;
+    char *end;
+    while ((opt = getopt(argc, argv, "hvacds:E:b:t:T:i:j:p:w:P:S:m:r:L:H:")) != -1) {
         switch (opt) {
         case 'h':
             print_help_options();
             exit(0);
         case 'v':
-            sc->verbose = 1;
+            cli->verbose = 1;
+            break;
+        case 'a':
+            cli->allassoc = 1;
+            break;
+        case 'c':
+            classify = 1;
+            break;
+        case 'd':
+            reuse = 1;
             break;
         case 's':
-            sc->s = atoi(optarg);
-            sc->setcnt = 0x01 << sc->s;
+            cfg.s = atoi(optarg);
             argcnt++;
             break;
         case 'E':
-            sc->linecnt = sc->E = atoi(optarg);
+            cfg.E = atoi(optarg);
             argcnt++;
             break;
         case 'b':
-            sc->b = atoi(optarg);
-            sc->blockcnt = 0x01 << sc->b;
+            cfg.b = atoi(optarg);
             argcnt++;
             break;
         case 't':
-            sc->tracefile = optarg;
+            cli->tracefile = optarg;
             argcnt++;
             break;
+        case 'i':
+            cli->interval = strtoul(optarg, &end, 10);
+            if (':' == *end) {
+                cli->intervalfile = end + 1;
+            } else if ('\0' != *end) {
+                cli->interval = 0;
+            }
+            if (0 == cli->interval) {
+                fprintf(stderr, "Bad interval %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'j':
+            cli->nthreads = atoi(optarg);
+            break;
+        case 'H':
+            cfg.levels = optarg;
+            break;
+        case 'S':
+            sampling = optarg;
+            break;
+        case 'r':
+            regionfile = optarg;
+            break;
+        case 'L':
+            cli->layouttop = atoi(optarg);
+            if (cli->layouttop < 1) {
+                fprintf(stderr, "Bad layout count %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'm':
+            if (!cli->pcs) {
+                cli->pcs = (pc_profile *) malloc(sizeof(pc_profile));
+            }
+            if (!cli->pcs) {
+                fprintf(stderr, "PC Memory allocation error!");
+                exit(1);
+            }
+            if (pc_profile_parse(optarg, cli->pcs) < 0) {
+                fprintf(stderr, "Bad PC report %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'P':
+            if (!sc->pf) {
+                sc->pf = (prefetcher *) malloc(sizeof(prefetcher));
+            }
+            if (!sc->pf) {
+                fprintf(stderr, "Prefetcher Memory allocation error!");
+                exit(1);
+            }
+            if (prefetch_parse(optarg, sc->pf) < 0) {
+                fprintf(stderr, "Bad prefetcher %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'w':
+            cfg.write = optarg;
+            cli->wreport = 1;
+            break;
+        case 'p':
+            cfg.policy = optarg;
+            break;
+        case 'T':
+            kind = trace_parse_kind(optarg);
+            if (kind < 0) {
+                fprintf(stderr, "Unknown trace reader %s\n", optarg);
+                exit(1);
+            }
+            cli->tracekind = kind;
+            break;
         default:
             print_help_options();
             exit(1);
@@ -193,263 +193,256 @@ void parse_cache_args(int argc, char *argv[], simulator_cache *sc)
         print_help_options();
         exit(1);
     }
-    // printf("v=%d, s=%d, E=%d, b=%d, t=%s.\n", sc->verbose, sc->setcnt, sc->linecnt, sc->blockcnt, sc->tracefile);
-    return;
-}
-
-/* Init simulator cache */
-void init_cache_matrix(simulator_cache *sc)
-{
-    // init cache matirx.
-    int i, j;
-    sc->sets = (cache_set *) malloc(sc->setcnt * sizeof(cache_set));
-    if(!sc->sets){
-        fprintf(stderr, "Set Memory allocation error!");
+    if (csim_configure(sc, &cfg, err, sizeof(err)) < 0) {
+        fprintf(stderr, "%s\n", err);
+        exit(1);
+    }
+    if (cli->allassoc && cfg.levels) {
+        fprintf(stderr, "-a profiles a single level only\n");
+        exit(1);
+    }
+    if (cli->allassoc && POLICY_LRU != sc->policy) {
+        fprintf(stderr, "-a profiles LRU only\n");
+        exit(1);
+    }
+    if (cli->allassoc && cli->wreport) {
+        fprintf(stderr, "-a does not model writes\n");
+        exit(1);
+    }
+    if (cli->allassoc && cli->interval) {
+        fprintf(stderr, "-a has no per-access statistics\n");
+        exit(1);
+    }
+    if (cli->allassoc && sc->pf) {
+        fprintf(stderr, "-a does not model prefetching\n");
         exit(1);
     }
-    for (i = 0; i < sc->setcnt; i++) {
-        sc->sets[i].cls = (cache_line *) malloc(sc->linecnt * sizeof(cache_line));
-        if(!sc->sets[i].cls){
-            fprintf(stderr, "Cache line Memory allocation error!");
+    if (classify) {
+        if (cli->allassoc) {
+            fprintf(stderr, "-a cannot classify misses\n");
             exit(1);
         }
-        for (j = 0; j < sc->linecnt; j++) {
-            sc->sets[i].cls[j].valid  = 0;
-            sc->sets[i].cls[j].tag    = -1;
-            sc->sets[i].cls[j].lrunum = LRU_INIT_NUM;
-            // sc->sets.cls[j].block = 0;
+        cli->mc = (miss_3c *) malloc(sizeof(miss_3c));
+        if (!cli->mc || miss_3c_init(cli->mc, sc->setcnt * sc->E) < 0) {
+            fprintf(stderr, "3C Memory allocation error!");
+            exit(1);
         }
     }
-    // obtain set mask and cache line mask.
-    int setmask = 1;
-    i = 0;
-    while (++i < sc->s) {
-        setmask = setmask << 1;
-        setmask |= 0x01;
-    }
-    setmask = setmask << sc->b;
-    sc->setmask = setmask;
-    sc->cs.evictions = sc->cs.hits = sc->cs.misses = 0;
-    // printf("cache matrix init successfully!\n");
-}
-
-/* Handle cache operations and record statistics */
-void handle_cache_stuff(simulator_cache *sc)
-{
-    FILE *fp = fopen(sc->tracefile, "r");
-    if(NULL == fp) {
-        fprintf(stderr, "%s: No such file or directory\n", sc->tracefile);
-        exit(1);
+    if (reuse) {
+        if (cli->allassoc) {
+            fprintf(stderr, "-a already profiles stack distances\n");
+            exit(1);
+        }
+        cli->rd = (reuse_profile *) malloc(sizeof(reuse_profile));
+        if (!cli->rd || reuse_profile_init(cli->rd, sc->b) < 0) {
+            fprintf(stderr, "Reuse Memory allocation error!");
+            exit(1);
+        }
     }
-    // init simulator cache 
-    init_cache_matrix(sc);
-    char linestr[LINE_LENGTH] = {0};
-    cache_opt co;
-    while(!feof(fp))
-    {
-        memset(linestr, 0, sizeof(linestr));
-        fgets(linestr, sizeof(linestr) - 1, fp); 
-        sscanf(linestr,"%c%c %x,%d", &co.inst, &co.opttype, &co.addr, &co.size);
-        char *t = trim_white_space(linestr);
-        if (0 == strcmp(t, ""))  {break;}
-        // if (0 == strcmp(linestr, " ") || 0 == strcmp(linestr, "")) {break;} // TODO: verify more carefully.
-        // printf("%c%c %x,%d\n",  co.inst, co.opttype, co.addr, co.size);
-        do_cache_opt(sc, co);
-    }
-    fclose(fp);
-}   
-
-/* Do normal cache opeartion */
-void do_cache_opt(simulator_cache *sc, cache_opt co)
-{
-    // instruction or data opt.
-    switch (co.inst) {
-    case 'I': // do instruction related opt.
-        return;
-    case ' ': // do data releated opt.
-        break;
-    default:
-        printf("Unreconginzed operation type %c!\n", co.inst);  // process continue.
-        return;
+    if (cli->pcs) {
+        if (cli->allassoc) {
+            fprintf(stderr, "-a has no per-access statistics\n");
+            exit(1);
+        }
+        if (pc_profile_init(cli->pcs) < 0) {
+            fprintf(stderr, "PC Memory allocation error!");
+            exit(1);
+        }
     }
-    // do task according to data operation type.
-    switch (co.opttype) {
-    case 'L': // do load data opt.
-        // printf("Do load data task.\n");
-        do_load_data(sc, co);
-        break;
-    case 'S': // do store data opt.
-        // printf("Do store data task.\n");
-        do_store_data(sc, co);
-        break;
-    case 'M': // do modify data opt.
-        // printf("Do modify data task.\n");
-        do_modify_data(sc, co);
-        break;
-    default:
-        printf("Unreconginzed data operation type %c!\n", co.opttype); // process continue.
-        return;
+    if (cli->layouttop) {
+        if (!regionfile) {
+            fprintf(stderr, "-L needs a region map (-r)\n");
+            exit(1);
+        }
+        if (cfg.levels || sc->pf || 0 == strcmp(cli->tracefile, "-")) {
+            fprintf(stderr, "-L re-reads the trace for an L1 without prefetching\n");
+            exit(1);
+        }
     }
-}
-
-/* Do base cache opt */
-void do_base_opt(simulator_cache *sc, cache_opt co, cache_opt_res *optres)
-{
-    // convert addr to hex.
-    
-    // locate set
-    int setno = (co.addr & sc->setmask) >> sc->b ;
-    // match cache line
-    int linemask = co.addr >> (sc->b + sc->s) << (sc->b + sc->s); // logical right shift and then turn left.
-    int tag = (co.addr & linemask);
-    int i = 0;
-    int miss = 1;
-    for (; i < sc->linecnt; i++) {
-        int valid = sc->sets[setno].cls[i].valid; // index check?
-        int tagbit = sc->sets[setno].cls[i].tag;
-        if (valid &&  tag == tagbit) {
-            miss = 0;
-            sc->cs.hits++;
-            *optres |= HIT;
-            // update access record.
-            sc->sets[setno].cls[i].lrunum = LRU_INIT_NUM;
-            for (int j = 0; j < sc->linecnt; j++) {
-                if (j != i) {
-                    sc->sets[setno].cls[j].lrunum--;
-                }
-            }
+    if (regionfile) {
+        if (cli->allassoc) {
+            fprintf(stderr, "-a has no per-access statistics\n");
+            exit(1);
+        }
+        cli->rg = (region_map *) malloc(sizeof(region_map));
+        if (!cli->rg) {
+            fprintf(stderr, "Region Memory allocation error!");
+            exit(1);
+        }
+        if (region_map_load(cli->rg, regionfile) < 0) {
+            exit(1);
         }
     }
-    if (miss) {
-        sc->cs.misses++;
-        *optres |= MISS;
-        // read data from RAM...
-        // update cache data
-        if(update_cache(sc, setno, tag)) {
-            sc->cs.evictions++;
-            *optres |= EVICTION;
+    if (sampling) {
+        double rate;
+        int smax;
+        if (shards_parse(sampling, &rate, &smax) < 0) {
+            fprintf(stderr, "Bad sampling %s\n", sampling);
+            exit(1);
+        }
+        if (cli->allassoc) {
+            fprintf(stderr, "-a already profiles stack distances\n");
+            exit(1);
+        }
+        cli->sh = (shards_profile *) malloc(sizeof(shards_profile));
+        if (!cli->sh || shards_init(cli->sh, rate, smax, sc->b) < 0) {
+            fprintf(stderr, "Sampling Memory allocation error!");
+            exit(1);
         }
     }
+    if (cli->mc || cli->rd || cli->sh || cli->pcs || cli->rg) {
+        sc->observe = observe_l1;
+        sc->observer = cli;
+    }
+    // printf("v=%d, s=%d, E=%d, b=%d, t=%s.\n", cli->verbose, sc->setcnt, sc->linecnt, sc->blockcnt, cli->tracefile);
     return;
 }
 
-/* Do load data task */
-void do_load_data(simulator_cache *sc, cache_opt co)
-{
-    cache_opt_res optres = 0;
-    do_base_opt(sc, co, &optres);
-    // print verbose if enable.
-    print_verbose(sc, co, optres, 1);
-    if (sc->verbose) printf("\n");
-}
-
-/* Do store data task */
-void do_store_data(simulator_cache *sc, cache_opt co)
-{
-    cache_opt_res optres = 0;
-    do_base_opt(sc, co, &optres);
-    // print verbose if enable.
-    print_verbose(sc, co, optres, 1);
-    if (sc->verbose) printf("\n");
-}
-
-/* Do modify data task */
-void do_modify_data(simulator_cache *sc, cache_opt co)
-{
-    cache_opt_res optres = 0;
-    do_base_opt(sc, co, &optres);
-    // print verbose if enable.
-    print_verbose(sc, co, optres, 1);
-    optres = 0;
-    do_base_opt(sc, co, &optres);
-    print_verbose(sc, co, optres, 0);
-    if (sc->verbose) printf("\n");
-
-}
-
-/* Update cache data struct and evict cache line by lru if necessary */
-int update_cache(simulator_cache *sc, int setno, int tag) 
+/* Simulate the trace, printing a CSV row of statistics every interval data accesses */
+static void handle_intervals(csim_cli *cli, trace_reader *tr)
 {
-    int i = 0;
-    int evicted = 1;
-    int lineno = 0;
-    for (; i < sc->linecnt; i++) { // check whether there is any  empty cache line.
-        if (sc->sets[setno].cls[i].valid == 0) {
-            evicted = 0;
-            break;
-        }
+    simulator_cache *sc = &cli->sc;
+    FILE *out = stdout;
+    cache_stats last = sc->cs;
+    unsigned long access = 0, first = 0, row = 0;
+    cache_opt co;
+    if (cli->intervalfile && !(out = fopen(cli->intervalfile, "w"))) {
+        fprintf(stderr, "%s: Cannot open interval file\n", cli->intervalfile);
+        exit(1);
     }
-    if (!evicted) { // remain empy cache line.
-        sc->sets[setno].cls[i].valid = 1;
-        sc->sets[setno].cls[i].tag = tag;
-        lineno = i;
-    } else { // full set, need do eviction by LRU.
-        int evindex = search_lru_cache_line(sc, setno);
-        sc->sets[setno].cls[evindex].valid = 1;
-        sc->sets[setno].cls[evindex].tag = tag;
-        lineno = evindex;
-    }
-    // update cache record.
-    sc->sets[setno].cls[lineno].lrunum = LRU_INIT_NUM;
-    for (int j = 0; j < sc->linecnt; j++) {
-        if (j != lineno) {
-            sc->sets[setno].cls[j].lrunum--;
+    fprintf(out, "interval,first_access,hits,misses,evictions,miss_rate\n");
+    for (;;) {
+        int more = trace_next(tr, &co);
+        if (more) {
+            do_cache_opt(cli, co);
         }
-    }
-    return evicted;
-}
-
-/* Search the specific cache line index according LRU */
-int search_lru_cache_line(simulator_cache *sc, int setno)
-{
-    int i = 0;
-    int evindex = 0;
-    int minlru = LRU_INIT_NUM;
-    for(; i < sc->linecnt; i++) {
-        if(sc->sets[setno].cls[i].lrunum < minlru){
-            evindex = i;
-            minlru = sc->sets[setno].cls[i].lrunum;
+        // L1 hits and misses count the data accesses as the summary does, a
+        // modify as two and I records not at all.
+        access = sc->cs.hits + sc->cs.misses;
+        // rows end every interval accesses, one later when a modify straddles
+        // the boundary, and once more at the trace end.
+        if (access - first >= cli->interval || (!more && access > first)) {
+            unsigned long hits = sc->cs.hits - last.hits, misses = sc->cs.misses - last.misses;
+            fprintf(out, "%lu,%lu,%lu,%lu,%lu,%.6f\n", row++, first, hits, misses,
+                    sc->cs.evictions - last.evictions,
+                    hits + misses ? (double) misses / (hits + misses) : 0.0);
+            last = sc->cs;
+            first = access;
+        }
+        if (!more) {
+            break;
         }
     }
-    return evindex;
-}
-
-/* Free simulator cache memory */
-void free_cache(simulator_cache *sc)
-{
-    int i = 0;
-    for (; i < sc->linecnt; i++) {
-        free(sc->sets[i].cls);
+    if (out != stdout) {
+        fclose(out);
     }
-    free(sc->sets);
-    // printf("Free simulator_cache successfully!\n");
 }
 
-/* Print cache opt result info */
-void print_verbose(simulator_cache *sc, cache_opt co, cache_opt_res optres, int flag)
+/* Handle cache operations and record statistics */
+void handle_cache_stuff(csim_cli *cli)
 {
-    if (sc->verbose) {
-        if (flag) {
-            printf("%c %x,%d", co.opttype, co.addr, co.size);
-        }
-        if (optres & HIT) {
-            printf(" hit");
-        }
-        if (optres & MISS) {
-            printf(" miss");
+    simulator_cache *sc = &cli->sc;
+    trace_reader tr;
+    int ret;
+    if ((ret = trace_open(&tr, cli->tracefile, cli->tracekind)) < 0) {
+        fprintf(stderr, "%s: %s\n", cli->tracefile, trace_strerror(ret));
+        exit(1);
+    }
+    cache_opt co;
+    if (cli->allassoc) {
+        if (stack_profile_init(&cli->sp, sc->s, sc->E, sc->b) < 0) {
+            fprintf(stderr, "Stack profile Memory allocation error!");
+            exit(1);
         }
-        if (optres & EVICTION) {
-            printf(" eviction");
+        while (trace_next(&tr, &co)) {
+            do_stack_opt(cli, co);
         }
+        trace_close(&tr);
+        return;
     }
-}
+    // init simulator cache 
+    if (init_cache_matrix(sc) < 0 || init_hier(sc) < 0) {
+        fprintf(stderr, "%s", csim_strerror(CSIM_ENOMEM));
+        exit(1);
+    }
+    if (cli->interval) { // a separate loop keeps the plain one branch free.
+        handle_intervals(cli, &tr);
+        trace_close(&tr);
+        return;
+    }
+    // verbose output needs trace order; lower levels, prefetchers and the
+    // 3C shadows are shared by all sets.
+    if (cli->nthreads > 1 && !cli->verbose && !sc->next && !sc->pf && !sc->observe) {
+        handle_cache_sharded(cli, &tr);
+        trace_close(&tr);
+        return;
+    }
+    // decode a batch ahead so the engine can host prefetch the sets to come.
+    cache_opt batch[CSIM_BATCH];
+    int n;
+    do {
+        for (n = 0; n < CSIM_BATCH && trace_next(&tr, &batch[n]); n++);
+        do_cache_batch(cli, batch, n);
+    } while (CSIM_BATCH == n);
+    trace_close(&tr);
+}   
 
 int main(int argc, char *argv[])
 {
-    simulator_cache sc;
-    parse_cache_args(argc, argv, &sc);
-    // test_mask(&sc);
-    handle_cache_stuff(&sc);
-    printSummary(sc.cs.hits, sc.cs.misses, sc.cs.evictions);
+    csim_cli cli = {0};
+    simulator_cache *sc = &cli.sc;
+    parse_cache_args(argc, argv, &cli);
+    // test_mask(sc);
+    handle_cache_stuff(&cli);
+    if (cli.allassoc) {
+        unsigned long hits, misses, evictions;
+        stack_profile_print(&cli.sp);
+        stack_profile_result(&cli.sp, sc->E, &hits, &misses, &evictions);
+        stack_profile_free(&cli.sp);
+        printSummary(hits, misses, evictions);
+        return 0;
+    }
+    if (sc->next) {
+        print_hier(sc);
+    }
+    if (cli.mc) {
+        miss_3c_print(cli.mc);
+        miss_3c_free(cli.mc);
+        free(cli.mc);
+    }
+    if (cli.rd) {
+        reuse_profile_print(cli.rd);
+        reuse_profile_free(cli.rd);
+        free(cli.rd);
+    }
+    if (cli.sh) {
+        shards_print(cli.sh);
+        shards_free(cli.sh);
+        free(cli.sh);
+    }
+    if (cli.pcs) {
+        pc_profile_print(cli.pcs);
+        pc_profile_free(cli.pcs);
+        free(cli.pcs);
+    }
+    if (cli.rg) {
+        region_map_print(cli.rg, sc->s, sc->b);
+        if (cli.layouttop) {
+            layout_advise(&cli, cli.layouttop);
+        }
+        region_map_free(cli.rg);
+        free(cli.rg);
+    }
+    if (sc->pf) {
+        prefetch_print(sc->pf);
+        free(sc->pf);
+    }
+    if (cli.wreport) {
+        printf("dirty_evictions:%lu writebacks:%lu write_bytes:%lu\n",
+               sc->cs.dirty_evictions, sc->cs.writebacks, sc->cs.write_bytes);
+    }
+    printSummary(sc->cs.hits, sc->cs.misses, sc->cs.evictions);
+    free_hier(sc);
+    free_cache(sc);
     return 0;
 }
\ No newline at end of file
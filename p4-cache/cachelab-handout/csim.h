@@ -0,0 +1,163 @@
+/*
+ * csim.h - Cache simulator types and engine entry points.
+ */
+#ifndef CSIM_H
+#define CSIM_H
+
+#include "csim_lib.h"
+#include "csim_trace.h"
+#include "csim_policy.h"
+#include "csim_prefetch.h"
+
+typedef unsigned cache_opt_res;
+
+#define CSIM_BATCH      256 // records decoded ahead of simulation
+#define CSIM_PF_AHEAD   8   // records between a host prefetch of a set and its use
+#define CSIM_PF_MIN     (1 << 20) // smaller arenas stay in the host caches, no prefetch
+/**
+ * NOTE: 
+ * I: nop
+ * L: miss; hit; miss eviction;
+ * S: miss; hit; miss eviction;
+ * M: miss, hit; miss eviction; hit, hit
+ */
+
+/* relation of a cache level to the levels above it */
+typedef enum {
+    HIER_NINE = 0, // non-inclusive non-exclusive
+    HIER_INCL,     // holds everything above, evictions back-invalidate
+    HIER_EXCL      // holds nothing above, filled by victims from above
+} hier_rel;
+
+/* simulator cache statistics info struct */
+typedef struct cache_stats_st {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long dirty_evictions; // evicted lines holding unwritten stores
+    unsigned long writebacks;      // writes sent to the next level or RAM
+    unsigned long write_bytes;
+} cache_stats;
+
+/* simulator cache struct */
+typedef struct simulator_cache_st {
+    csim_config cfg;   // as given to csim_configure()
+    int setcnt;
+    int linecnt;
+    int blockcnt;
+
+    int s, E, b;
+
+    cache_stats cs;
+
+    /*
+     * Cache state lives in one arena cut into groups of 2^grpshift sets.
+     * Each group is a small structure-of-arrays at the offsets below, so a
+     * set's tags are contiguous and can be matched with SIMD compares, and
+     * a group fits one page when sets are small enough: a large arena is
+     * only reserved, the first touch of a set faults in one page, and sets
+     * never touched cost nothing. A line's stamp is its set's clock at the
+     * last access, 0 while the line is empty.
+     */
+    void *arena;
+    size_t arenabytes;
+    int hostpf;               // arena is large enough to host prefetch its sets
+    int mapped;               // arena is an mmap reservation, else page aligned malloc'd
+    int grpshift;             // log2 of the sets per group
+    size_t grpbytes;          // bytes per group, a power of 2 up to a page, else a multiple of 8
+    /* offsets in a group; stamps start it */
+    size_t offclocks;         // per-set access counter, bumped on every touch
+    size_t offbits;           // per-set policy bits, see csim_policy.h
+    size_t offtags;           // low word of the tag addr >> (s + b)
+    size_t offtagshi;         // high word, only read when the low word matches
+    size_t offaux;            // per-line policy word, see csim_policy.h
+    size_t offdirty;          // per-line dirty bit, write-back only
+    size_t offpref;           // per-line flag, prefetched and not used yet
+    fa_lru *fa;               // tag -> line index of a POLICY_FA_HASH cache, else NULL
+
+    /* write handling of this level, see parse_write_mode() */
+    int wthrough;      // stores are written through instead of marking lines dirty
+    int nwalloc;       // store misses bypass the cache instead of filling a line
+
+    prefetcher *pf;    // L1 prefetcher, NULL if none
+    unsigned long long pc; // address of the last I record
+    unsigned long long victim; // address of the last demand victim
+
+    cache_policy policy;
+    unsigned long seed; // random/brrip seed
+    /* do_base_opt specialized for this geometry, NULL for the generic one; see csim_kernel.h */
+    void (*kernel)(struct simulator_cache_st *sc, cache_stats *cs, cache_opt co, cache_opt_res *optres);
+    /* called after every access with observer, NULL in libcsim handles; csim's analyses hook in here */
+    void (*observe)(void *observer, cache_opt co, cache_opt_res optres);
+    void *observer;
+
+    /* cache hierarchy, the CLI cache is L1; see csim_hier.c */
+    int level;
+    hier_rel rel;
+    struct simulator_cache_st *next; // towards memory, NULL for the last level
+    struct simulator_cache_st *prev; // towards the core, NULL for L1
+    unsigned long fills;         // blocks filled from the level below
+    unsigned long victims;       // victim blocks received from the level above
+    unsigned long invalidations; // lines dropped by back-invalidation
+
+    unsigned long long setmask;
+} simulator_cache;
+
+/******************** custome function declaration ******************************************/
+/* Init simulator cache, 0 on success */
+int init_cache_matrix(simulator_cache *sc);
+
+/* Empty the cache and zero its statistics */
+void reset_cache_matrix(simulator_cache *sc);
+
+/* Parse "wb|wt[:wa|nwa]" write handling, -1 if unknown */
+int parse_write_mode(const char *arg, simulator_cache *sc);
+
+/* Check a level's geometry, 0 if its set count 2^s and block size 2^b fit an int, else -1 */
+int check_geometry(int s, int E, int b);
+
+/* Apply cfg to the zeroed sc and parse its lower levels, CSIM_EINVAL/ENOMEM with a message in err */
+int csim_configure(simulator_cache *sc, const csim_config *cfg, char *err, size_t errlen);
+
+/* Do base cache opt */
+void do_base_opt(simulator_cache *sc, cache_stats *cs, cache_opt co, cache_opt_res *optres);
+
+/* Insert a victim block from the level above without a demand access */
+void insert_cache_line(simulator_cache *sc, unsigned long long addr);
+
+/* Prefetch the block holding addr into sc, return 0 if it was present */
+int prefetch_line(simulator_cache *sc, unsigned long long addr);
+
+/* Drop the block holding addr if present, return 1 if it was */
+int invalidate_cache_line(simulator_cache *sc, unsigned long long addr, int *dirty);
+
+/* Send a write of bytes at addr from level sc towards memory */
+void write_next(simulator_cache *sc, cache_stats *cs, unsigned long long addr, int bytes);
+
+/*
+ * Parse -H lower level list and link the levels below sc, 0 on success,
+ * CSIM_EINVAL or CSIM_ENOMEM with a message in err[errlen] on error
+ */
+int parse_hier_spec(simulator_cache *sc, const char *spec, char *err, size_t errlen);
+
+/* Init cache matrices of the levels below sc, 0 on success */
+int init_hier(simulator_cache *sc);
+
+/* Propagate the eviction of the block at addr from level sc, 1 if it got dirty data */
+int hier_evict(simulator_cache *sc, unsigned long long addr);
+
+/* Print per-level statistics and memory traffic */
+void print_hier(simulator_cache *sc);
+
+/* Free the levels below sc */
+void free_hier(simulator_cache *sc);
+
+/* Start loading the host cache lines of the set addr maps to, no simulated effect */
+void host_prefetch_set(const simulator_cache *sc, unsigned long long addr);
+
+/* Free simulator cache memory */
+void free_cache(simulator_cache *sc);
+
+/******************** custome function declaration end ******************************************/
+
+#endif /* CSIM_H */
@@ -0,0 +1,106 @@
+/*
+ * csim_3c.c - 3C miss classification and its shadow structures.
+ *
+ * The seen set uses linear probing over a power-of-2 slot array with a
+ * multiplicative hash; the fully associative shadow is csim_fa.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim_3c.h"
+
+#define BLOCK_SET_MIN  1024
+
+/* Slot of block, before probing */
+static inline size_t block_hash(unsigned long long block, size_t mask)
+{
+    return (size_t) ((block * 0x9e3779b97f4a7c15ULL) >> 17) & mask;
+}
+
+/* Insert key into a slot array without growing, return 1 if it was new */
+static int block_set_put(unsigned long long *keys, size_t mask, unsigned long long key)
+{
+    size_t h = block_hash(key - 1, mask);
+    while (keys[h]) {
+        if (keys[h] == key) {
+            return 0;
+        }
+        h = (h + 1) & mask;
+    }
+    keys[h] = key;
+    return 1;
+}
+
+/* Add block to the set, return 1 if it was not there, -1 on allocation error */
+static int block_set_add(block_set *bs, unsigned long long block)
+{
+    if (2 * (bs->count + 1) > bs->mask + 1) { // keep the load at most 1/2.
+        size_t i, newmask = 2 * (bs->mask + 1) - 1;
+        unsigned long long *keys = (unsigned long long *) calloc(newmask + 1, sizeof(unsigned long long));
+        if (!keys) {
+            return -1;
+        }
+        for (i = 0; i <= bs->mask; i++) {
+            if (bs->keys[i]) block_set_put(keys, newmask, bs->keys[i]);
+        }
+        free(bs->keys);
+        bs->keys = keys;
+        bs->mask = newmask;
+    }
+    if (block_set_put(bs->keys, bs->mask, block + 1)) {
+        bs->count++;
+        return 1;
+    }
+    return 0;
+}
+
+/* Init classifier for a cache of nlines lines, 0 on success */
+int miss_3c_init(miss_3c *mc, int nlines)
+{
+    memset(mc, 0, sizeof(*mc));
+    mc->seen.mask = BLOCK_SET_MIN - 1;
+    mc->seen.keys = (unsigned long long *) calloc(BLOCK_SET_MIN, sizeof(unsigned long long));
+    if (!mc->seen.keys || fa_lru_init(&mc->fa, nlines) < 0) {
+        miss_3c_free(mc);
+        return -1;
+    }
+    return 0;
+}
+
+/* Account one demand access to block, miss tells whether the real cache missed */
+void miss_3c_access(miss_3c *mc, unsigned long long block, int miss)
+{
+    unsigned long long victim;
+    int evicted;
+    int first = block_set_add(&mc->seen, block);
+    int fahit = fa_lru_access(&mc->fa, block, &evicted, &victim);
+    if (first < 0) {
+        fprintf(stderr, "3C Memory allocation error!");
+        exit(1);
+    }
+    if (!miss) {
+        return;
+    }
+    if (first) {
+        mc->compulsory++;
+    } else if (!fahit) {
+        mc->capacity++;
+    } else {
+        mc->conflict++;
+    }
+}
+
+/* Print classification */
+void miss_3c_print(miss_3c *mc)
+{
+    printf("compulsory:%lu capacity:%lu conflict:%lu\n",
+           mc->compulsory, mc->capacity, mc->conflict);
+}
+
+/* Free classifier memory */
+void miss_3c_free(miss_3c *mc)
+{
+    free(mc->seen.keys);
+    fa_lru_free(&mc->fa);
+    memset(mc, 0, sizeof(*mc));
+}
@@ -0,0 +1,44 @@
+/*
+ * csim_3c.h - Compulsory / capacity / conflict miss classification.
+ *
+ * Every L1 demand access also goes to two shadow structures:
+ *   seen    hash set of every block ever touched
+ *   fa      fully associative LRU cache with the same number of lines
+ * A miss of the real cache is compulsory if its block was never seen,
+ * capacity if the fully associative cache misses as well, and conflict
+ * otherwise. Both shadows are O(1) per access.
+ */
+#ifndef CSIM_3C_H
+#define CSIM_3C_H
+
+#include "csim_fa.h"
+
+/* growable hash set of block numbers */
+typedef struct block_set_st {
+    unsigned long long *keys; // block + 1, 0 is an empty slot
+    size_t mask;              // slot count - 1, a power of 2 minus 1
+    size_t count;
+} block_set;
+
+/* 3C classifier struct */
+typedef struct miss_3c_st {
+    block_set seen;
+    fa_lru fa;
+    unsigned long compulsory;
+    unsigned long capacity;
+    unsigned long conflict;
+} miss_3c;
+
+/* Init classifier for a cache of nlines lines, 0 on success */
+int miss_3c_init(miss_3c *mc, int nlines);
+
+/* Account one demand access to block, miss tells whether the real cache missed */
+void miss_3c_access(miss_3c *mc, unsigned long long block, int miss);
+
+/* Print classification */
+void miss_3c_print(miss_3c *mc);
+
+/* Free classifier memory */
+void miss_3c_free(miss_3c *mc);
+
+#endif /* CSIM_3C_H */
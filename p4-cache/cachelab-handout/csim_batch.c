@@ -0,0 +1,494 @@
+/*
+ * csim_batch.c - Simulate many cache configurations over many traces.
+ *
+ * Each trace is parsed once into memory, then every configuration runs
+ * over it as an independent libcsim handle on a work-stealing thread
+ * pool: the tasks are dealt round-robin onto per-worker deques, a worker
+ * pops its own deque from the back and, once that is empty, steals from
+ * the front of the others. The workers are started once and sleep on a
+ * condition variable between traces. While the pool simulates one trace
+ * the main thread parses the next one. All results go to one CSV table,
+ * in trace and configuration order whatever the thread schedule.
+ */
+#define _POSIX_C_SOURCE 200809L // strdup, sysconf
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "csim_lib.h"
+#include "csim_trace.h"
+
+#define BATCH_MAX_VALUES 64 // values per s, E or b list
+
+/* a trace held in memory */
+typedef struct batch_trace_st {
+    const char *path;
+    csim_ref *refs;
+    size_t n;
+} batch_trace;
+
+/* one simulation: a configuration over the current trace */
+typedef struct batch_task_st {
+    const csim_config *cfg;
+    csim_stats st;
+    int err;           // CSIM_OK or the error of csim_create
+} batch_task;
+
+/* tasks of one worker, the owner pops the back and thieves take the front */
+typedef struct task_deque_st {
+    int *ids;
+    int head, tail;    // ids[head .. tail-1] still to run
+    pthread_mutex_t lock;
+} task_deque;
+
+/* thread pool struct */
+typedef struct batch_pool_st {
+    int nworkers;
+    task_deque *dq;
+    pthread_t *tids;
+    batch_task *tasks;
+    const batch_trace *tr;
+
+    /* hand-off of one trace to the workers */
+    unsigned long round;    // bumped for every trace dealt
+    int busy;               // workers not yet done with this round
+    int quit;               // no more rounds will come
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+} batch_pool;
+
+/* worker argument */
+typedef struct batch_worker_st {
+    batch_pool *pool;
+    int id;
+} batch_worker;
+
+/* Print help options */
+void usage(char *argv[])
+{
+    printf("Usage: %s [-h] [-j <num>] [-T <kind>] [-o <file>] -c <config>... [-f <file>] <trace>...\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -c <spec>  Configurations s:E:b[:policy]; s, E and b are comma separated\n");
+    printf("             numbers or lo-hi ranges, every combination is simulated.\n");
+    printf("  -f <file>  Read more -c specs from <file>, one per line, # comments.\n");
+    printf("  -j <num>   Worker threads (default: online CPUs).\n");
+    printf("  -T <kind>  Trace reader: mmap (default), stdio or bin.\n");
+    printf("  -o <file>  Write the CSV table to <file> instead of stdout.\n");
+    printf("\n");
+    printf("Examples:\n");
+    printf("  linux>  %s -c 5:1:5 -c 4:2:4 traces/yi.trace traces/long.trace\n", argv[0]);
+    printf("  linux>  %s -j 8 -c 4-12:1,2,4,8,16:6 -c 6:8:6:plru traces/*.trace\n", argv[0]);
+}
+
+/* Pop a task of worker id, stealing from the others once its own deque is empty; -1 when all are done */
+static int batch_pop(batch_pool *pool, int id)
+{
+    int k, task = -1;
+    for (k = 0; k < pool->nworkers && task < 0; k++) {
+        task_deque *dq = &pool->dq[(id + k) % pool->nworkers];
+        pthread_mutex_lock(&dq->lock);
+        if (dq->head < dq->tail) {
+            // own work newest first, stolen work oldest first.
+            task = k ? dq->ids[dq->head++] : dq->ids[--dq->tail];
+        }
+        pthread_mutex_unlock(&dq->lock);
+    }
+    return task; // no task is added once the workers run, so empty means done.
+}
+
+/* Worker thread body, run the tasks of every round until the pool quits */
+static void *batch_worker_main(void *arg)
+{
+    batch_worker *w = (batch_worker *) arg;
+    batch_pool *pool = w->pool;
+    unsigned long seen = 0;
+    int id;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->round == seen && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->round == seen) { // quit.
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->round;
+        pthread_mutex_unlock(&pool->lock);
+
+        while ((id = batch_pop(pool, w->id)) >= 0) {
+            batch_task *t = &pool->tasks[id];
+            csim *c;
+            t->err = csim_create(t->cfg, &c, NULL, 0);
+            if (CSIM_OK != t->err) {
+                continue;
+            }
+            csim_access_batch(c, pool->tr->refs, pool->tr->n);
+            csim_get_stats(c, 1, &t->st);
+            csim_destroy(c);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (0 == --pool->busy) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+/* Start the idle workers of pool */
+static void batch_pool_start(batch_pool *pool, batch_worker *workers)
+{
+    int i;
+    pool->round = 0;
+    pool->busy = 0;
+    pool->quit = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (i = 0; i < pool->nworkers; i++) {
+        workers[i].pool = pool;
+        workers[i].id = i;
+        if (pthread_create(&pool->tids[i], NULL, batch_worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Cannot create worker thread\n");
+            exit(1);
+        }
+    }
+}
+
+/* Deal the tasks of trace tr onto the deques of the idle workers and wake them */
+static void batch_start(batch_pool *pool, const batch_trace *tr, int ntasks)
+{
+    int i;
+    pool->tr = tr;
+    for (i = 0; i < pool->nworkers; i++) {
+        pool->dq[i].head = pool->dq[i].tail = 0;
+    }
+    for (i = 0; i < ntasks; i++) {
+        task_deque *dq = &pool->dq[i % pool->nworkers];
+        dq->ids[dq->tail++] = i;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->busy = pool->nworkers;
+    pool->round++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Wait until every worker is done with the current trace */
+static void batch_wait(batch_pool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* Let the idle workers exit and join them */
+static void batch_pool_stop(batch_pool *pool)
+{
+    int i;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->nworkers; i++) {
+        pthread_join(pool->tids[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+
+/* Write str as a CSV field, quoted if it holds a comma, quote or line break */
+static void csv_field(FILE *out, const char *str)
+{
+    if (!strpbrk(str, ",\"\r\n")) {
+        fputs(str, out);
+        return;
+    }
+    putc('"', out);
+    for (; *str; str++) {
+        if ('"' == *str) {
+            putc('"', out); // doubled.
+        }
+        putc(*str, out);
+    }
+    putc('"', out);
+}
+
+/* Read the data records of path into memory */
+static void batch_load(batch_trace *bt, const char *path, trace_kind kind)
+{
+    trace_reader tr;
+    cache_opt co;
+    size_t cap = 1 << 16;
+    int ret;
+    bt->path = path;
+    bt->n = 0;
+    bt->refs = (csim_ref *) malloc(cap * sizeof(csim_ref));
+    if (!bt->refs) {
+        fprintf(stderr, "Trace Memory allocation error!");
+        exit(1);
+    }
+    if ((ret = trace_open(&tr, path, kind)) < 0) {
+        fprintf(stderr, "%s: %s\n", path, trace_strerror(ret));
+        exit(1);
+    }
+    while (trace_next(&tr, &co)) {
+        if (' ' != co.inst) { // instruction fetches are not simulated.
+            continue;
+        }
+        if (bt->n == cap) {
+            csim_ref *refs = (csim_ref *) realloc(bt->refs, 2 * cap * sizeof(csim_ref));
+            if (!refs) {
+                fprintf(stderr, "Trace Memory allocation error!");
+                exit(1);
+            }
+            bt->refs = refs;
+            cap *= 2;
+        }
+        bt->refs[bt->n].op = co.opttype;
+        bt->refs[bt->n].size = co.size;
+        bt->refs[bt->n].addr = co.addr;
+        bt->n++;
+    }
+    trace_close(&tr);
+}
+
+/* Parse "a,b,lo-hi..." in [arg, end) into vals, return the count or -1 if invalid */
+static int parse_values(const char *arg, const char *end, int *vals)
+{
+    int n = 0;
+    while (arg < end) {
+        char *next;
+        long lo = strtol(arg, &next, 10), hi = lo, v;
+        if (next == arg || lo < 0) {
+            return -1;
+        }
+        if ('-' == *next) {
+            arg = next + 1;
+            hi = strtol(arg, &next, 10);
+            if (next == arg || hi < lo) {
+                return -1;
+            }
+        }
+        for (v = lo; v <= hi; v++) {
+            if (n == BATCH_MAX_VALUES) {
+                return -1;
+            }
+            vals[n++] = (int) v;
+        }
+        if (next < end && ',' != *next) {
+            return -1;
+        }
+        arg = next < end ? next + 1 : end;
+    }
+    return n;
+}
+
+/* Expand spec "s:E:b[:policy]" into *cfgs, return -1 if invalid */
+static int parse_spec(const char *spec, csim_config **cfgs, int *ncfg, int *cap)
+{
+    int vals[3][BATCH_MAX_VALUES], cnt[3], f, i, j, k;
+    const char *arg = spec, *policy = NULL;
+    for (f = 0; f < 3; f++) {
+        const char *colon = strchr(arg, ':');
+        const char *end = colon ? colon : arg + strlen(arg);
+        if ((f < 2 && !colon) || (cnt[f] = parse_values(arg, end, vals[f])) <= 0) {
+            return -1;
+        }
+        arg = colon ? colon + 1 : end;
+        if (2 == f && colon && !(policy = strdup(arg))) { // the rest, a policy may carry its own :seed.
+            fprintf(stderr, "Config Memory allocation error!");
+            exit(1);
+        }
+    }
+    for (i = 0; i < cnt[0]; i++) {
+        for (j = 0; j < cnt[1]; j++) {
+            for (k = 0; k < cnt[2]; k++) {
+                if (*ncfg == *cap) {
+                    *cap = *cap ? 2 * *cap : 64;
+                    *cfgs = (csim_config *) realloc(*cfgs, *cap * sizeof(csim_config));
+                    if (!*cfgs) {
+                        fprintf(stderr, "Config Memory allocation error!");
+                        exit(1);
+                    }
+                }
+                csim_config *cfg = &(*cfgs)[(*ncfg)++];
+                memset(cfg, 0, sizeof(*cfg));
+                cfg->s = vals[0][i];
+                cfg->E = vals[1][j];
+                cfg->b = vals[2][k];
+                cfg->policy = policy; // shared by the configurations of this spec.
+            }
+        }
+    }
+    return 0;
+}
+
+/* Add the specs of file path, one per line */
+static void parse_spec_file(const char *path, csim_config **cfgs, int *ncfg, int *cap)
+{
+    char line[256];
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "%s: No such file or directory\n", path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line + strspn(line, " \t");
+        p[strcspn(p, " \t\r\n#")] = '\0';
+        if (*p && parse_spec(p, cfgs, ncfg, cap) < 0) {
+            fprintf(stderr, "%s: Bad configuration \"%s\", want s:E:b[:policy]\n", path, p);
+            exit(1);
+        }
+    }
+    fclose(fp);
+}
+
+int main(int argc, char *argv[])
+{
+    csim_config *cfgs = NULL;
+    int ncfg = 0, cap = 0, nworkers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int kind = TRACE_MMAP, i, t, ret;
+    char *outfile = NULL;
+    FILE *out = stdout;
+    char c;
+    while ((c = getopt(argc, argv, "hc:f:j:T:o:")) != -1) {
+        switch (c) {
+        case 'c':
+            if (parse_spec(optarg, &cfgs, &ncfg, &cap) < 0) {
+                fprintf(stderr, "Bad configuration \"%s\", want s:E:b[:policy]\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'f':
+            parse_spec_file(optarg, &cfgs, &ncfg, &cap);
+            break;
+        case 'j':
+            nworkers = atoi(optarg);
+            break;
+        case 'T':
+            if ((kind = trace_parse_kind(optarg)) < 0) {
+                fprintf(stderr, "Unknown trace reader %s\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (0 == ncfg || optind == argc) {
+        printf("Error: Missing required argument\n");
+        usage(argv);
+        exit(1);
+    }
+    if (nworkers < 1) {
+        nworkers = 1;
+    }
+    // reject bad configurations before any simulation starts.
+    for (i = 0; i < ncfg; i++) {
+        char err[256];
+        csim *sim;
+        if (csim_create(&cfgs[i], &sim, err, sizeof(err)) != CSIM_OK) {
+            fprintf(stderr, "%d:%d:%d: %s\n", cfgs[i].s, cfgs[i].E, cfgs[i].b, err);
+            exit(1);
+        }
+        csim_destroy(sim);
+    }
+    // and missing traces, rather than fail after the first ones are done.
+    for (t = optind; t < argc; t++) {
+        trace_reader tr;
+        if ((ret = trace_open(&tr, argv[t], (trace_kind) kind)) < 0) {
+            fprintf(stderr, "%s: %s\n", argv[t], trace_strerror(ret));
+            exit(1);
+        }
+        trace_close(&tr);
+    }
+    if (outfile && !(out = fopen(outfile, "w"))) {
+        fprintf(stderr, "%s: Cannot open output file\n", outfile);
+        exit(1);
+    }
+
+    batch_pool pool;
+    batch_worker *workers = (batch_worker *) malloc(nworkers * sizeof(batch_worker));
+    batch_trace cur, next = {0};
+    pool.nworkers = nworkers;
+    pool.dq = (task_deque *) calloc(nworkers, sizeof(task_deque));
+    pool.tids = (pthread_t *) malloc(nworkers * sizeof(pthread_t));
+    pool.tasks = (batch_task *) calloc(ncfg, sizeof(batch_task));
+    if (!workers || !pool.dq || !pool.tids || !pool.tasks) {
+        fprintf(stderr, "Pool Memory allocation error!");
+        exit(1);
+    }
+    for (i = 0; i < nworkers; i++) {
+        pool.dq[i].ids = (int *) malloc((ncfg / nworkers + 1) * sizeof(int));
+        if (!pool.dq[i].ids) {
+            fprintf(stderr, "Pool Memory allocation error!");
+            exit(1);
+        }
+        pthread_mutex_init(&pool.dq[i].lock, NULL);
+    }
+    for (i = 0; i < ncfg; i++) {
+        pool.tasks[i].cfg = &cfgs[i];
+    }
+
+    batch_pool_start(&pool, workers);
+    batch_load(&cur, argv[optind], (trace_kind) kind);
+    fprintf(out, "trace,s,E,b,policy,hits,misses,evictions,miss_rate\n");
+    for (t = optind; t < argc; t++) {
+        batch_start(&pool, &cur, ncfg);
+        if (t + 1 < argc) { // parse the next trace meanwhile.
+            batch_load(&next, argv[t + 1], (trace_kind) kind);
+        }
+        batch_wait(&pool);
+        for (i = 0; i < ncfg; i++) {
+            const batch_task *bt = &pool.tasks[i];
+            unsigned long acc = bt->st.hits + bt->st.misses;
+            if (CSIM_OK != bt->err) {
+                fprintf(stderr, "%s: %d:%d:%d: %s\n", cur.path, bt->cfg->s, bt->cfg->E, bt->cfg->b,
+                        csim_strerror(bt->err));
+                exit(1);
+            }
+            csv_field(out, cur.path);
+            fprintf(out, ",%d,%d,%d,", bt->cfg->s, bt->cfg->E, bt->cfg->b);
+            csv_field(out, bt->cfg->policy ? bt->cfg->policy : "lru");
+            fprintf(out, ",%lu,%lu,%lu,%.6f\n", bt->st.hits, bt->st.misses,
+                    bt->st.evictions, acc ? (double) bt->st.misses / acc : 0.0);
+        }
+        free(cur.refs);
+        cur = next;
+    }
+    batch_pool_stop(&pool);
+    if (out != stdout) {
+        fclose(out);
+    }
+    for (i = 0; i < nworkers; i++) {
+        pthread_mutex_destroy(&pool.dq[i].lock);
+        free(pool.dq[i].ids);
+    }
+    free(pool.dq);
+    free(pool.tids);
+    free(pool.tasks);
+    free(workers);
+    for (i = 0; i < ncfg; i++) { // one policy string per spec.
+        if (cfgs[i].policy && (0 == i || cfgs[i].policy != cfgs[i - 1].policy)) {
+            free((char *) cfgs[i].policy);
+        }
+    }
+    free(cfgs);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * csim_cli.h - The csim command line around the engine: the trace, run
+ * options and L1 analyses of one csim run, which a libcsim handle does
+ * not carry, and the drivers in csim.c, csim_run.c and csim_shard.c.
+ */
+#ifndef CSIM_CLI_H
+#define CSIM_CLI_H
+
+#include "csim.h"
+#include "csim_stack.h"
+#include "csim_3c.h"
+#include "csim_reuse.h"
+#include "csim_pc.h"
+#include "csim_region.h"
+#include "csim_layout.h"
+
+/* csim run struct */
+typedef struct csim_cli_st {
+    simulator_cache sc; // the L1, the lower levels hang off sc.next
+
+    char *tracefile;
+    trace_kind tracekind;
+    int verbose;
+    int wreport;       // -w given, print the write statistics
+    int nthreads;      // set-sharded worker threads, 0 or 1 is serial
+    unsigned long interval;  // data accesses per -i time series row, 0 if off
+    const char *intervalfile; // -i CSV output, NULL for stdout
+
+    /* L1 analyses, fed by observe_l1() */
+    miss_3c *mc;       // miss classifier, NULL if none
+    reuse_profile *rd; // reuse distance profile, NULL if none
+    shards_profile *sh; // sampled miss ratio curve, NULL if none
+    pc_profile *pcs;   // misses per PC, NULL if none
+    region_map *rg;    // per region statistics, NULL if none
+    int layouttop;     // -L layouts printed, 0 if off
+
+    int allassoc;      // profile every E in 1..E in one pass
+    stack_profile sp;
+} csim_cli;
+
+/* Print help options */
+void print_help_options();
+
+/* Parse simulator cache args */
+void parse_cache_args(int argc, char *argv[], csim_cli *cli);
+
+/* Handle cache operations and record statistics */
+void handle_cache_stuff(csim_cli *cli);
+
+/* Handle cache operations on set-sharded worker threads */
+void handle_cache_sharded(csim_cli *cli, trace_reader *tr);
+
+/* Do normal cache opeartion */
+void do_cache_opt(csim_cli *cli, cache_opt co);
+
+/* Feed the L1 access co with result optres to the analyses of csim run cli */
+void observe_l1(void *cli, cache_opt co, cache_opt_res optres);
+
+/* Do n cache operations in trace order, host prefetching the sets of those ahead */
+void do_cache_batch(csim_cli *cli, const cache_opt *ops, int n);
+
+/* Do stack distance profile opeartion */
+void do_stack_opt(csim_cli *cli, cache_opt co);
+
+/* Do load data task */
+void do_load_data(csim_cli *cli, cache_opt co);
+
+/* Do store data task */
+void do_store_data(csim_cli *cli, cache_opt co);
+
+/* Do modify data task */
+void do_modify_data(csim_cli *cli, cache_opt co);
+
+/* Print cache opt result info */
+void print_verbose(csim_cli *cli, cache_opt co, cache_opt_res optres, int flag);
+
+#endif /* CSIM_CLI_H */
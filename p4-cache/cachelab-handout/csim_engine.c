@@ -0,0 +1,551 @@
+/*
+ * csim_engine.c - The simulation engine: cache matrix, replacement and
+ * write handling. It never prints or exits; the trace driver and the
+ * analyses of the csim command line are in csim_run.c.
+ */
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, MAP_NORESERVE, madvise
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "csim.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* cache operation result type, the CSIM_* bits of csim_lib.h */
+static const cache_opt_res HIT      = CSIM_HIT;
+static const cache_opt_res MISS     = CSIM_MISS;
+static const cache_opt_res EVICTION = CSIM_EVICTION;
+static const cache_opt_res DIRTY    = 0x1000; // block handed up by an exclusive level was dirty
+
+#define ARENA_PAGE     4096      // a group of sets is kept within one page if it can be
+#define ARENA_MAP_MIN  (1 << 20) // arenas from this size are reserved with mmap
+
+typedef void (*cache_kernel)(simulator_cache *sc, cache_stats *cs, cache_opt co, cache_opt_res *optres);
+
+static cache_kernel find_kernel(const simulator_cache *sc);
+
+/* one set's slices of the arena, see set_view() */
+typedef struct cache_set_st {
+    unsigned long *stamps;
+    unsigned long *clock;
+    unsigned long long *bits;
+    unsigned int *tags;
+    unsigned int *tagshi;
+    unsigned int *aux;
+    unsigned char *dirty;
+    unsigned char *pref;
+} cache_set;
+
+/* Lay out groups of 2^shift sets, return bytes per group */
+static size_t layout_groups(simulator_cache *sc, int shift)
+{
+    size_t nsets = (size_t) 1 << shift, nlines = nsets * sc->linecnt, bytes;
+    // stamps | clocks | bits | tags | tagshi | aux | dirty | pref.
+    sc->offclocks = nlines * sizeof(unsigned long);
+    sc->offbits = sc->offclocks + nsets * sizeof(unsigned long);
+    sc->offtags = sc->offbits + nsets * sizeof(unsigned long long);
+    sc->offtagshi = sc->offtags + nlines * sizeof(unsigned int);
+    sc->offaux = sc->offtagshi + nlines * sizeof(unsigned int);
+    sc->offdirty = sc->offaux + nlines * sizeof(unsigned int);
+    sc->offpref = sc->offdirty + nlines * sizeof(unsigned char);
+    sc->grpshift = shift;
+    bytes = (sc->offpref + nlines * sizeof(unsigned char) + 7) & ~(size_t) 7;
+    if (bytes <= ARENA_PAGE) {
+        // a power of 2 divides the page, so no group of the page aligned arena straddles two.
+        for (sc->grpbytes = 8; sc->grpbytes < bytes; sc->grpbytes <<= 1);
+    } else {
+        sc->grpbytes = bytes;
+    }
+    return sc->grpbytes;
+}
+
+/* Init simulator cache, 0 on success */
+int init_cache_matrix(simulator_cache *sc)
+{
+    // init cache matirx: the largest groups of sets that fit a page, one group at least.
+    int shift = sc->s;
+    while (shift > 0 && layout_groups(sc, shift) > ARENA_PAGE) {
+        shift--;
+    }
+    layout_groups(sc, shift);
+    sc->arenabytes = sc->grpbytes << (sc->s - shift);
+    sc->mapped = sc->arenabytes >= ARENA_MAP_MIN;
+    sc->hostpf = sc->arenabytes >= CSIM_PF_MIN;
+    if (sc->mapped) {
+        // reserve only, the kernel zero-fills each page on its first touch.
+        void *p = mmap(NULL, sc->arenabytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        sc->arena = MAP_FAILED == p ? NULL : p;
+    } else if (posix_memalign(&sc->arena, ARENA_PAGE, sc->arenabytes) != 0) {
+        sc->arena = NULL;
+    } else {
+        memset(sc->arena, 0, sc->arenabytes);
+    }
+    if(!sc->arena){
+        return -1;
+    }
+    // obtain set mask, empty when there is a single set (s = 0).
+    sc->setmask = (unsigned long long) (sc->setcnt - 1) << sc->b;
+    sc->fa = NULL;
+    if (0 == sc->s && POLICY_LRU == sc->policy && sc->linecnt >= FA_HASH_MIN_WAYS) {
+        // one big LRU set: find lines by hash instead of scanning them.
+        sc->fa = (fa_lru *) malloc(sizeof(fa_lru));
+        if (!sc->fa || fa_lru_init(sc->fa, sc->linecnt) < 0) {
+            free(sc->fa);
+            sc->fa = NULL;
+            free_cache(sc);
+            return -1;
+        }
+        sc->policy = POLICY_FA_HASH;
+    }
+    sc->kernel = find_kernel(sc);
+    sc->cs.evictions = sc->cs.hits = sc->cs.misses = 0;
+    sc->cs.dirty_evictions = sc->cs.writebacks = sc->cs.write_bytes = 0;
+    // printf("cache matrix init successfully!\n");
+    return 0;
+}
+
+/* Empty the cache and zero its statistics */
+void reset_cache_matrix(simulator_cache *sc)
+{
+    if (sc->mapped) { // drop the pages, they come back zeroed when touched.
+        madvise(sc->arena, sc->arenabytes, MADV_DONTNEED);
+    } else {
+        memset(sc->arena, 0, sc->arenabytes);
+    }
+    memset(&sc->cs, 0, sizeof(cache_stats));
+    if (sc->fa) fa_lru_reset(sc->fa);
+    sc->fills = sc->victims = sc->invalidations = 0;
+}
+
+/* Set number of addr */
+static inline int addr_set(const simulator_cache *sc, unsigned long long addr)
+{
+    return (int) ((addr & sc->setmask) >> sc->b);
+}
+
+/* Tag of addr, the bits above set index and block offset */
+static inline unsigned long long addr_tag(const simulator_cache *sc, unsigned long long addr)
+{
+    return addr >> (sc->b + sc->s);
+}
+
+/* Slices of set setno in its group */
+static inline __attribute__((always_inline))
+void set_view(const simulator_cache *sc, int setno, cache_set *set)
+{
+    size_t k = (size_t) setno & (((size_t) 1 << sc->grpshift) - 1);
+    size_t base = k * sc->linecnt;
+    char *grp = (char *) sc->arena + ((size_t) setno >> sc->grpshift) * sc->grpbytes;
+    set->stamps = (unsigned long *) grp + base;
+    set->clock = (unsigned long *) (grp + sc->offclocks) + k;
+    set->bits = (unsigned long long *) (grp + sc->offbits) + k;
+    set->tags = (unsigned int *) (grp + sc->offtags) + base;
+    set->tagshi = (unsigned int *) (grp + sc->offtagshi) + base;
+    set->aux = (unsigned int *) (grp + sc->offaux) + base;
+    set->dirty = (unsigned char *) (grp + sc->offdirty) + base;
+    set->pref = (unsigned char *) (grp + sc->offpref) + base;
+}
+
+/*
+ * Start loading the host cache lines of the set addr maps to. Once the
+ * simulated cache outgrows the host caches, every access stalls on its
+ * set's tags and stamps; touching them a few records early overlaps
+ * those misses with the simulation of the records in between.
+ */
+void host_prefetch_set(const simulator_cache *sc, unsigned long long addr)
+{
+    cache_set set;
+    if (sc->fa) { // one set, the hash slot is what misses.
+        fa_lru_prefetch(sc->fa, addr_tag(sc, addr));
+        return;
+    }
+    set_view(sc, addr_set(sc, addr), &set);
+    __builtin_prefetch(set.tags, 0);
+    __builtin_prefetch(set.stamps, 1);
+    __builtin_prefetch(set.clock, 1);
+}
+
+/*
+ * Match tag against the lines of set, return the line index
+ * or -1. The low tag words are compared 8 (AVX2) or 4 (SSE2) lanes at a
+ * time; a lane only counts when the high word matches too and its line
+ * is valid, i.e. has a non-zero stamp.
+ */
+static inline int match_cache_line(const simulator_cache *sc, const cache_set *set, unsigned long long tag)
+{
+    const unsigned int *tags = set->tags;
+    const unsigned int *tagshi = set->tagshi;
+    const unsigned long *stamps = set->stamps;
+    const unsigned int lo = (unsigned int) tag, hi = (unsigned int) (tag >> 32);
+    int E = sc->linecnt;
+    int i = 0, j;
+    unsigned m;
+#if defined(__AVX2__)
+    __m256i key8 = _mm256_set1_epi32((int) lo);
+    for (; i + 8 <= E; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (tags + i)), key8);
+        for (m = _mm256_movemask_ps(_mm256_castsi256_ps(eq)); m; m &= m - 1) {
+            j = i + __builtin_ctz(m);
+            if (tagshi[j] == hi && stamps[j]) return j;
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i key4 = _mm_set1_epi32((int) lo);
+    for (; i + 4 <= E; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (tags + i)), key4);
+        for (m = _mm_movemask_ps(_mm_castsi128_ps(eq)); m; m &= m - 1) {
+            j = i + __builtin_ctz(m);
+            if (tagshi[j] == hi && stamps[j]) return j;
+        }
+    }
+#endif
+    (void) m;
+    (void) j;
+    for (; i < E; i++) {
+        if (tags[i] == lo && tagshi[i] == hi && stamps[i]) return i;
+    }
+    return -1;
+}
+
+/* Line of tag in set, -1 if none */
+static inline int find_cache_line(const simulator_cache *sc, const cache_set *set, unsigned long long tag,
+                                  const cache_policy policy)
+{
+    if (POLICY_FA_HASH == policy) {
+        return fa_lru_find(sc->fa, tag);
+    }
+    return match_cache_line(sc, set, tag);
+}
+
+/* Empty line i of set, it becomes the first choice for the next fill */
+static inline void clear_cache_line(simulator_cache *sc, cache_set *set, int i)
+{
+    if (sc->fa) fa_lru_clear(sc->fa, i);
+    set->stamps[i] = 0;
+    set->aux[i] = 0;
+    set->dirty[i] = 0;
+    set->pref[i] = 0;
+}
+
+/* Fill tag into set setno for one replacement policy, evicting if needed; return its line */
+static inline __attribute__((always_inline))
+int fill_policy(simulator_cache *sc, cache_stats *cs, cache_set *set, int setno, unsigned long long tag,
+                int dirty, cache_opt_res *optres, policy_set *ps, const cache_policy policy)
+{
+    int i = policy_victim(ps, policy);
+    if (ps->stamps[i]) {
+        unsigned long long vtag = (unsigned long long) set->tagshi[i] << 32 | set->tags[i];
+        unsigned long long victim = vtag << (sc->b + sc->s) | (unsigned long long) setno << sc->b;
+        int wb = set->dirty[i];
+        sc->victim = victim;
+        cs->evictions++;
+        *optres |= EVICTION;
+        if (set->pref[i]) { // prefetched and never used.
+            sc->pf->polluting++;
+        }
+        if (sc->next || sc->prev) { // the victim may matter to other levels.
+            wb |= hier_evict(sc, victim);
+        }
+        if (wb) { // write the victim back before its line is reused.
+            cs->dirty_evictions++;
+            write_next(sc, cs, victim, sc->blockcnt);
+        }
+    }
+    set->tags[i] = (unsigned int) tag;
+    set->tagshi[i] = (unsigned int) (tag >> 32);
+    set->dirty[i] = dirty;
+    set->pref[i] = 0;
+    if (POLICY_FA_HASH == policy) fa_lru_set(sc->fa, i, tag);
+    policy_fill(ps, i, policy);
+    return i;
+}
+
+/* Do base cache opt for one replacement policy */
+static inline __attribute__((always_inline))
+void base_opt_policy(simulator_cache *sc, cache_stats *cs, cache_opt co, cache_opt_res *optres,
+                     const cache_policy policy)
+{
+    // locate set
+    int setno = addr_set(sc, co.addr);
+    // match cache line
+    unsigned long long tag = addr_tag(sc, co.addr);
+    cache_set set;
+    set_view(sc, setno, &set);
+    policy_set ps = {
+        set.stamps, set.aux, set.bits, set.clock,
+        sc->linecnt, setno, sc->seed, sc->fa
+    };
+    int store = ('S' == co.opttype); // the store half of M is passed as S.
+    int i = find_cache_line(sc, &set, tag, policy);
+    if (i >= 0) {
+        cs->hits++;
+        *optres |= HIT;
+        if (HIER_EXCL == sc->rel) { // the block moves up and leaves this level.
+            if (set.dirty[i]) *optres |= DIRTY;
+            clear_cache_line(sc, &set, i);
+            return;
+        }
+        // update access record.
+        policy_touch(&ps, i, policy);
+        if (store) {
+            if (sc->wthrough) write_next(sc, cs, co.addr, co.size);
+            else set.dirty[i] = 1;
+        }
+        if (sc->pf) {
+            int used = set.pref[i]; // first use of a prefetched line.
+            if (used) {
+                set.pref[i] = 0;
+                if (prefetch_late(sc->pf, co.addr >> sc->b)) sc->pf->late++;
+                else sc->pf->useful++;
+            }
+            prefetch_access(sc, co.addr, used);
+        }
+        return;
+    }
+    cs->misses++;
+    *optres |= MISS;
+    if (store && sc->nwalloc) { // write around the cache.
+        write_next(sc, cs, co.addr, co.size);
+        if (sc->pf) prefetch_access(sc, co.addr, 1);
+        return;
+    }
+    // read data from the next level or RAM...
+    cache_opt_res lowres = 0;
+    if (sc->next) {
+        cache_opt lowco = co;
+        lowco.opttype = 'L'; // a fill only reads the block below.
+        do_base_opt(sc->next, &sc->next->cs, lowco, &lowres);
+    }
+    if (HIER_EXCL == sc->rel) { // exclusive levels are filled by victims only.
+        *optres |= lowres & DIRTY; // pass dirty data below on up to the level that fills.
+        return;
+    }
+    // update cache data
+    fill_policy(sc, cs, &set, setno, tag, (store && !sc->wthrough) || (lowres & DIRTY),
+                optres, &ps, policy);
+    sc->fills++;
+    if (store && sc->wthrough) {
+        write_next(sc, cs, co.addr, co.size);
+    }
+    if (sc->pf) {
+        prefetch_access(sc, co.addr, 1);
+    }
+}
+
+/* geometry specialized kernels: the test-csim configurations, then common L1 and L2 shapes */
+#define KS 1
+#define KE 1
+#define KB 1
+#include "csim_kernel.h"
+#define KS 4
+#define KE 2
+#define KB 4
+#include "csim_kernel.h"
+#define KS 2
+#define KE 1
+#define KB 4
+#include "csim_kernel.h"
+#define KS 2
+#define KE 1
+#define KB 3
+#include "csim_kernel.h"
+#define KS 2
+#define KE 2
+#define KB 3
+#include "csim_kernel.h"
+#define KS 2
+#define KE 4
+#define KB 3
+#include "csim_kernel.h"
+#define KS 5
+#define KE 1
+#define KB 5
+#include "csim_kernel.h"
+#define KS 6
+#define KE 8
+#define KB 6
+#include "csim_kernel.h"
+#define KS 6
+#define KE 12
+#define KB 6
+#include "csim_kernel.h"
+#define KS 10
+#define KE 8
+#define KB 6
+#include "csim_kernel.h"
+#define KS 10
+#define KE 16
+#define KB 6
+#include "csim_kernel.h"
+#define KS 11
+#define KE 16
+#define KB 6
+#include "csim_kernel.h"
+
+/* kernel table entry */
+typedef struct kernel_entry_st {
+    int s, E, b;
+    cache_kernel fn;
+} kernel_entry;
+
+static const kernel_entry kernels[] = {
+    {1, 1, 1, kernel_1_1_1}, {4, 2, 4, kernel_4_2_4}, {2, 1, 4, kernel_2_1_4},
+    {2, 1, 3, kernel_2_1_3}, {2, 2, 3, kernel_2_2_3}, {2, 4, 3, kernel_2_4_3},
+    {5, 1, 5, kernel_5_1_5}, {6, 8, 6, kernel_6_8_6}, {6, 12, 6, kernel_6_12_6},
+    {10, 8, 6, kernel_10_8_6}, {10, 16, 6, kernel_10_16_6}, {11, 16, 6, kernel_11_16_6},
+};
+
+/* Kernel for the geometry of sc, NULL if it has none or needs the generic path */
+static cache_kernel find_kernel(const simulator_cache *sc)
+{
+    size_t k;
+    if (POLICY_LRU != sc->policy || sc->next || sc->prev || sc->pf || sc->wthrough || sc->nwalloc) {
+        return NULL;
+    }
+    for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (kernels[k].s == sc->s && kernels[k].E == sc->E && kernels[k].b == sc->b) {
+            return kernels[k].fn;
+        }
+    }
+    return NULL;
+}
+
+/* Do base cache opt, one specialized copy per replacement policy */
+void do_base_opt(simulator_cache *sc, cache_stats *cs, cache_opt co, cache_opt_res *optres)
+{
+    if (sc->kernel) {
+        sc->kernel(sc, cs, co, optres);
+    } else {
+        POLICY_DISPATCH(sc->policy, base_opt_policy, sc, cs, co, optres);
+    }
+    if (sc->observe) { // only the csim L1 has analyses.
+        sc->observe(sc, co, *optres);
+    }
+}
+
+/* Insert a victim block from the level above, policy specialized */
+static inline __attribute__((always_inline))
+void insert_policy(simulator_cache *sc, unsigned long long addr, const cache_policy policy)
+{
+    int setno = addr_set(sc, addr);
+    unsigned long long tag = addr_tag(sc, addr);
+    cache_opt_res optres = 0;
+    cache_set set;
+    set_view(sc, setno, &set);
+    policy_set ps = {
+        set.stamps, set.aux, set.bits, set.clock,
+        sc->linecnt, setno, sc->seed, sc->fa
+    };
+    int i = find_cache_line(sc, &set, tag, policy);
+    if (i >= 0) {
+        policy_touch(&ps, i, policy);
+        return;
+    }
+    fill_policy(sc, &sc->cs, &set, setno, tag, 0, &optres, &ps, policy);
+}
+
+/* Insert a victim block from the level above without a demand access */
+void insert_cache_line(simulator_cache *sc, unsigned long long addr)
+{
+    sc->victims++;
+    POLICY_DISPATCH(sc->policy, insert_policy, sc, addr);
+}
+
+/* Prefetch the block holding addr, policy specialized */
+static inline __attribute__((always_inline))
+void prefetch_policy(simulator_cache *sc, unsigned long long addr, int *issued, const cache_policy policy)
+{
+    int setno = addr_set(sc, addr);
+    unsigned long long tag = addr_tag(sc, addr);
+    cache_opt_res optres = 0, lowres = 0;
+    cache_set set;
+    set_view(sc, setno, &set);
+    policy_set ps = {
+        set.stamps, set.aux, set.bits, set.clock,
+        sc->linecnt, setno, sc->seed, sc->fa
+    };
+    if (find_cache_line(sc, &set, tag, policy) >= 0) {
+        return;
+    }
+    if (sc->next) { // read it from below like a demand fill.
+        cache_opt lowco = {' ', 'L', 1, addr};
+        do_base_opt(sc->next, &sc->next->cs, lowco, &lowres);
+    }
+    int i = fill_policy(sc, &sc->cs, &set, setno, tag, (lowres & DIRTY) != 0, &optres, &ps, policy);
+    sc->fills++;
+    set.pref[i] = 1;
+    *issued = 1;
+}
+
+/* Prefetch the block holding addr into sc, return 0 if it was present */
+int prefetch_line(simulator_cache *sc, unsigned long long addr)
+{
+    int issued = 0;
+    unsigned long long victim = sc->victim; // keep the demand victim for -r.
+    POLICY_DISPATCH(sc->policy, prefetch_policy, sc, addr, &issued);
+    sc->victim = victim;
+    return issued;
+}
+
+/* Drop the block holding addr if present, return 1 if it was */
+int invalidate_cache_line(simulator_cache *sc, unsigned long long addr, int *dirty)
+{
+    int setno = addr_set(sc, addr);
+    unsigned long long tag = addr_tag(sc, addr);
+    cache_set set;
+    set_view(sc, setno, &set);
+    int i = find_cache_line(sc, &set, tag, sc->policy);
+    if (i < 0) {
+        return 0;
+    }
+    *dirty |= set.dirty[i];
+    clear_cache_line(sc, &set, i);
+    return 1;
+}
+
+/*
+ * Send a write of bytes at addr from level sc towards memory. A level
+ * below that holds the block takes it as a dirty line; one that does not
+ * passes it on without allocating, and counts it as its own write.
+ */
+void write_next(simulator_cache *sc, cache_stats *cs, unsigned long long addr, int bytes)
+{
+    cs->writebacks++;
+    cs->write_bytes += bytes;
+    simulator_cache *lv = sc->next;
+    if (!lv) {
+        return;
+    }
+    int setno = addr_set(lv, addr);
+    cache_set set;
+    set_view(lv, setno, &set);
+    int i = find_cache_line(lv, &set, addr_tag(lv, addr), lv->policy);
+    if (i >= 0 && !lv->wthrough) {
+        set.dirty[i] = 1;
+        return;
+    }
+    write_next(lv, &lv->cs, addr, bytes);
+}
+
+/* Free simulator cache memory */
+void free_cache(simulator_cache *sc)
+{
+    if (sc->mapped) {
+        if (sc->arena) munmap(sc->arena, sc->arenabytes);
+    } else {
+        free(sc->arena);
+    }
+    sc->arena = NULL;
+    if (sc->fa) {
+        fa_lru_free(sc->fa);
+        free(sc->fa);
+        sc->fa = NULL;
+    }
+    // printf("Free simulator_cache successfully!\n");
+}
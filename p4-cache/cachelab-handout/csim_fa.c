@@ -0,0 +1,188 @@
+/*
+ * csim_fa.c - Hash and recency list of the fully associative LRU index.
+ *
+ * The hash keeps its load at most 1/2 and deletes by shifting later
+ * entries of the probe run back, so there are no tombstones and lookups
+ * never slow down over a long trace. Nothing is written at init: lines
+ * are set up when first handed out, and the calloc'd hash of a large
+ * cache only costs the pages its blocks land on.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "csim_fa.h"
+
+/* Slot of block, before probing */
+static inline size_t fa_hash(unsigned long long block, size_t mask)
+{
+    return (size_t) ((block * 0x9e3779b97f4a7c15ULL) >> 17) & mask;
+}
+
+/* Init fully associative LRU cache of cap lines, 0 on success */
+int fa_lru_init(fa_lru *fa, int cap)
+{
+    size_t slots = 1;
+    memset(fa, 0, sizeof(*fa));
+    while (slots < 2 * (size_t) cap) slots <<= 1;
+    fa->cap = cap;
+    fa->mask = slots - 1;
+    fa->prev = (int *) malloc(cap * sizeof(int));
+    fa->next = (int *) malloc(cap * sizeof(int));
+    fa->blocks = (unsigned long long *) malloc(cap * sizeof(unsigned long long));
+    fa->keys = (unsigned long long *) calloc(slots, sizeof(unsigned long long));
+    fa->slotline = (int *) malloc(slots * sizeof(int));
+    if (!fa->prev || !fa->next || !fa->blocks || !fa->keys || !fa->slotline) {
+        fa_lru_free(fa);
+        return -1;
+    }
+    fa->freehead = fa->head = fa->tail = -1;
+    return 0;
+}
+
+/* Empty every line */
+void fa_lru_reset(fa_lru *fa)
+{
+    fa->nlines = 0;
+    fa->freehead = fa->head = fa->tail = -1;
+    memset(fa->keys, 0, (fa->mask + 1) * sizeof(unsigned long long));
+}
+
+/* Unlink line from the recency list */
+static inline void fa_unlink(fa_lru *fa, int line)
+{
+    if (fa->prev[line] >= 0) fa->next[fa->prev[line]] = fa->next[line];
+    else fa->head = fa->next[line];
+    if (fa->next[line] >= 0) fa->prev[fa->next[line]] = fa->prev[line];
+    else fa->tail = fa->prev[line];
+}
+
+/* Link line in as the MRU one */
+static inline void fa_push_front(fa_lru *fa, int line)
+{
+    fa->prev[line] = -1;
+    fa->next[line] = fa->head;
+    if (fa->head >= 0) fa->prev[fa->head] = line;
+    else fa->tail = line;
+    fa->head = line;
+}
+
+/* Remove block's hash slot, shifting its probe run back over it */
+static void fa_delete(fa_lru *fa, unsigned long long block)
+{
+    size_t i, j, k;
+    for (i = fa_hash(block, fa->mask); fa->keys[i] != block + 1; i = (i + 1) & fa->mask);
+    for (j = i;;) {
+        j = (j + 1) & fa->mask;
+        if (!fa->keys[j]) {
+            break;
+        }
+        k = fa_hash(fa->keys[j] - 1, fa->mask);
+        // move j back to i unless its home slot k lies cyclically in (i, j].
+        if ((i < j) ? (k <= i || k > j) : (k <= i && k > j)) {
+            fa->keys[i] = fa->keys[j];
+            fa->slotline[i] = fa->slotline[j];
+            i = j;
+        }
+    }
+    fa->keys[i] = 0;
+}
+
+/* Line holding block, -1 if none */
+int fa_lru_find(const fa_lru *fa, unsigned long long block)
+{
+    size_t h;
+    for (h = fa_hash(block, fa->mask); fa->keys[h]; h = (h + 1) & fa->mask) {
+        if (fa->keys[h] == block + 1) {
+            return fa->slotline[h];
+        }
+    }
+    return -1;
+}
+
+/* Start loading the host cache line of block's hash slot */
+void fa_lru_prefetch(const fa_lru *fa, unsigned long long block)
+{
+    __builtin_prefetch(&fa->keys[fa_hash(block, fa->mask)], 0);
+}
+
+/* Make line the MRU one */
+void fa_lru_touch(fa_lru *fa, int line)
+{
+    if (line != fa->head) {
+        fa_unlink(fa, line);
+        fa_push_front(fa, line);
+    }
+}
+
+/* Line to fill next: a cleared or unused one, else the LRU one */
+int fa_lru_victim(fa_lru *fa)
+{
+    int line;
+    if (fa->freehead >= 0) {
+        line = fa->freehead;
+        fa->freehead = fa->next[line];
+        return line;
+    }
+    if (fa->nlines < fa->cap) {
+        line = fa->nlines++;
+        fa->prev[line] = FA_DEAD;
+        return line;
+    }
+    return fa->tail;
+}
+
+/* Line now holds block as the MRU line, dropping the block it held */
+void fa_lru_set(fa_lru *fa, int line, unsigned long long block)
+{
+    size_t h;
+    if (FA_DEAD != fa->prev[line]) {
+        fa_delete(fa, fa->blocks[line]);
+        fa_unlink(fa, line);
+    }
+    for (h = fa_hash(block, fa->mask); fa->keys[h]; h = (h + 1) & fa->mask);
+    fa->keys[h] = block + 1;
+    fa->slotline[h] = line;
+    fa->blocks[line] = block;
+    fa_push_front(fa, line);
+}
+
+/* Drop the block of line, the line is handed out again first */
+void fa_lru_clear(fa_lru *fa, int line)
+{
+    if (FA_DEAD == fa->prev[line]) {
+        return;
+    }
+    fa_delete(fa, fa->blocks[line]);
+    fa_unlink(fa, line);
+    fa->prev[line] = FA_DEAD;
+    fa->next[line] = fa->freehead;
+    fa->freehead = line;
+}
+
+/* Access block, return 1 on hit; a miss that evicts sets *evicted and *victim */
+int fa_lru_access(fa_lru *fa, unsigned long long block, int *evicted, unsigned long long *victim)
+{
+    int line = fa_lru_find(fa, block);
+    *evicted = 0;
+    if (line >= 0) {
+        fa_lru_touch(fa, line);
+        return 1;
+    }
+    line = fa_lru_victim(fa);
+    if (FA_DEAD != fa->prev[line]) {
+        *evicted = 1;
+        *victim = fa->blocks[line];
+    }
+    fa_lru_set(fa, line, block);
+    return 0;
+}
+
+/* Free fully associative LRU cache */
+void fa_lru_free(fa_lru *fa)
+{
+    free(fa->prev);
+    free(fa->next);
+    free(fa->blocks);
+    free(fa->keys);
+    free(fa->slotline);
+    memset(fa, 0, sizeof(*fa));
+}
@@ -0,0 +1,64 @@
+/*
+ * csim_fa.h - Fully associative LRU cache index with O(1) operations.
+ *
+ * A linear probing hash maps each block to its line and a doubly linked
+ * list orders the lines by recency, so lookup, touch and eviction cost
+ * the same at 64K lines as at 8. The 3C classifier uses it as its shadow
+ * cache, and the engine uses it in place of the tag scan and stamp scan
+ * of a large -s 0 LRU cache (POLICY_FA_HASH).
+ *
+ * Lines are numbered 0 .. cap-1 so the engine can keep its per-line
+ * arrays. Lines dropped out of order (fa_lru_clear) are chained through
+ * next[] and handed out again before the LRU line is evicted.
+ */
+#ifndef CSIM_FA_H
+#define CSIM_FA_H
+
+#include <stddef.h>
+
+#define FA_DEAD -2 // prev[] of a line that holds no block
+
+/* fully associative LRU cache index struct */
+typedef struct fa_lru_st {
+    int cap;                    // lines
+    int nlines;                 // lines ever handed out
+    int freehead;               // first cleared line, -1 if none
+    int head, tail;             // MRU and LRU line, -1 if none
+    int *prev, *next;           // recency list links per line
+    unsigned long long *blocks; // block held by each line
+    unsigned long long *keys;   // hash slots, block + 1, 0 is empty
+    int *slotline;              // line of each hash slot
+    size_t mask;                // slot count - 1
+} fa_lru;
+
+/* Init fully associative LRU cache of cap lines, 0 on success */
+int fa_lru_init(fa_lru *fa, int cap);
+
+/* Empty every line */
+void fa_lru_reset(fa_lru *fa);
+
+/* Line holding block, -1 if none */
+int fa_lru_find(const fa_lru *fa, unsigned long long block);
+
+/* Start loading the host cache line of block's hash slot */
+void fa_lru_prefetch(const fa_lru *fa, unsigned long long block);
+
+/* Make line the MRU one */
+void fa_lru_touch(fa_lru *fa, int line);
+
+/* Line to fill next: a cleared or unused one, else the LRU one */
+int fa_lru_victim(fa_lru *fa);
+
+/* Line now holds block as the MRU line, dropping the block it held */
+void fa_lru_set(fa_lru *fa, int line, unsigned long long block);
+
+/* Drop the block of line, the line is handed out again first */
+void fa_lru_clear(fa_lru *fa, int line);
+
+/* Access block, return 1 on hit; a miss that evicts sets *evicted and *victim */
+int fa_lru_access(fa_lru *fa, unsigned long long block, int *evicted, unsigned long long *victim);
+
+/* Free fully associative LRU cache */
+void fa_lru_free(fa_lru *fa);
+
+#endif /* CSIM_FA_H */
@@ -0,0 +1,204 @@
+/*
+ * csim_hier.c - Multi-level cache hierarchy.
+ *
+ * The cache given by -s/-E/-b is L1; -H adds levels below it, each with
+ * its own geometry, replacement policy and relation to the levels above:
+ *
+ *   nine  non-inclusive: filled on demand misses, evicts silently
+ *   incl  inclusive: filled on demand misses, and every eviction
+ *         back-invalidates the block from all levels above
+ *   excl  exclusive: never filled on a demand miss; a hit hands the block
+ *         up and drops it here, and the level above inserts its victims
+ *
+ * A miss at level k is forwarded to level k+1 before level k fills, so a
+ * back-invalidation caused by the lower fill frees a line for it.
+ */
+#define _DEFAULT_SOURCE // strsep, strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim.h"
+
+#define HIER_MAX_LEVELS 8
+
+static const char *hier_rel_names[] = {"nine", "incl", "excl"};
+
+/* Parse one "s:E:b[:rel][:policy]" level, 0 on success */
+static int parse_level(simulator_cache *lv, char *spec)
+{
+    char *tok[3];
+    char *rest = spec;
+    int i, kind;
+    for (i = 0; i < 3; i++) {
+        tok[i] = strsep(&rest, ":");
+        if (NULL == tok[i] || '\0' == *tok[i]) {
+            return -1;
+        }
+    }
+    lv->s = atoi(tok[0]);
+    lv->linecnt = lv->E = atoi(tok[1]);
+    lv->b = atoi(tok[2]);
+    if (check_geometry(lv->s, lv->E, lv->b) < 0) {
+        return -1;
+    }
+    lv->setcnt = 0x01 << lv->s;
+    lv->blockcnt = 0x01 << lv->b;
+    lv->rel = HIER_NINE;
+    lv->policy = POLICY_LRU;
+    if (NULL == rest) {
+        return 0;
+    }
+    for (i = 0; i < 3; i++) {
+        size_t len = strlen(hier_rel_names[i]);
+        if (0 == strncmp(rest, hier_rel_names[i], len)
+            && (':' == rest[len] || '\0' == rest[len])) {
+            lv->rel = i;
+            rest += len + (':' == rest[len]);
+            break;
+        }
+    }
+    if ('\0' == *rest) {
+        return 0;
+    }
+    kind = policy_parse(rest, &lv->seed);
+    if (kind < 0) {
+        return -1;
+    }
+    lv->policy = kind;
+    return 0;
+}
+
+/*
+ * Parse -H lower level list and link the levels below sc, 0 on success,
+ * CSIM_EINVAL or CSIM_ENOMEM with a message in err[errlen] on error
+ */
+int parse_hier_spec(simulator_cache *sc, const char *spec, char *err, size_t errlen)
+{
+    char *copy = strdup(spec);
+    char *rest = copy;
+    char *item;
+    simulator_cache *up = sc;
+    if (!copy) {
+        snprintf(err, errlen, "Hierarchy Memory allocation error!");
+        return CSIM_ENOMEM;
+    }
+    while ((item = strsep(&rest, ",")) != NULL) {
+        simulator_cache *lv = (simulator_cache *) calloc(1, sizeof(simulator_cache));
+        if (!lv) {
+            snprintf(err, errlen, "Hierarchy Memory allocation error!");
+            free(copy);
+            return CSIM_ENOMEM;
+        }
+        if (up->level >= HIER_MAX_LEVELS) {
+            snprintf(err, errlen, "At most %d cache levels", HIER_MAX_LEVELS);
+            free(lv);
+            free(copy);
+            return CSIM_EINVAL;
+        }
+        // before parse_level() cuts the item up.
+        snprintf(err, errlen, "Bad cache level \"%s\", want s:E:b[:incl|excl|nine][:policy]", item);
+        if (parse_level(lv, item) < 0) {
+            free(lv);
+            free(copy);
+            return CSIM_EINVAL;
+        }
+        if (POLICY_TREE_PLRU == lv->policy
+            && (lv->E > PLRU_MAX_WAYS || (lv->E & (lv->E - 1)))) {
+            snprintf(err, errlen, "Tree PLRU needs E to be a power of 2 up to %d", PLRU_MAX_WAYS);
+            free(lv);
+            free(copy);
+            return CSIM_EINVAL;
+        }
+        if (HIER_EXCL == lv->rel && lv->b != up->b) {
+            snprintf(err, errlen, "Exclusive L%d needs the block size of L%d", up->level + 1, up->level);
+            free(lv);
+            free(copy);
+            return CSIM_EINVAL;
+        }
+        lv->level = up->level + 1;
+        lv->prev = up;
+        up->next = lv;
+        up = lv;
+    }
+    free(copy);
+    err[0] = '\0';
+    return 0;
+}
+
+/* Init cache matrices of the levels below sc, 0 on success */
+int init_hier(simulator_cache *sc)
+{
+    simulator_cache *lv;
+    for (lv = sc->next; lv; lv = lv->next) {
+        if (init_cache_matrix(lv) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Back-invalidate the block [addr, addr + 2^b) from the levels above lv,
+ * return 1 if any dropped copy was dirty; its data leaves with lv's victim.
+ */
+static int back_invalidate(simulator_cache *lv, unsigned long long addr)
+{
+    simulator_cache *up;
+    int dirty = 0;
+    for (up = lv->prev; up; up = up->prev) {
+        if (up->b >= lv->b) {
+            up->invalidations += invalidate_cache_line(up, addr, &dirty);
+        } else { // the lower block spans several upper blocks.
+            unsigned long long a, end = addr + (0x01ULL << lv->b);
+            for (a = addr; a != end; a += 0x01ULL << up->b) {
+                up->invalidations += invalidate_cache_line(up, a, &dirty);
+            }
+        }
+    }
+    return dirty;
+}
+
+/* Propagate the eviction of the block at addr from level sc, 1 if it got dirty data */
+int hier_evict(simulator_cache *sc, unsigned long long addr)
+{
+    int dirty = 0;
+    if (HIER_INCL == sc->rel) {
+        dirty = back_invalidate(sc, addr);
+    }
+    if (sc->next && HIER_EXCL == sc->next->rel) {
+        insert_cache_line(sc->next, addr);
+    }
+    return dirty;
+}
+
+/* Print per-level statistics and memory traffic */
+void print_hier(simulator_cache *sc)
+{
+    simulator_cache *lv, *last = sc;
+    for (lv = sc; lv; lv = lv->next) {
+        printf("L%d (s=%d E=%d b=%d %s %s) hits:%lu misses:%lu evictions:%lu"
+               " invalidations:%lu fill_bytes:%lu victim_bytes:%lu write_bytes:%lu\n",
+               lv->level, lv->s, lv->E, lv->b, hier_rel_names[lv->rel],
+               policy_name(lv->policy), lv->cs.hits, lv->cs.misses,
+               lv->cs.evictions, lv->invalidations, lv->fills << lv->b,
+               lv->victims << lv->b, lv->cs.write_bytes);
+        last = lv;
+    }
+    // blocks the last level could not supply come from memory, its writes go there.
+    printf("memory read_bytes:%lu write_bytes:%lu\n",
+           last->cs.misses << last->b, last->cs.write_bytes);
+}
+
+/* Free the levels below sc */
+void free_hier(simulator_cache *sc)
+{
+    simulator_cache *lv = sc->next;
+    while (lv) {
+        simulator_cache *next = lv->next;
+        free_cache(lv);
+        free(lv);
+        lv = next;
+    }
+    sc->next = NULL;
+}
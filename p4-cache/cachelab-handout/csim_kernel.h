@@ -0,0 +1,70 @@
+/*
+ * csim_kernel.h - do_base_opt() specialized for one cache geometry.
+ *
+ * This is a C template: csim_engine.c includes it once per common
+ * geometry with KS, KE and KB defined as literals, and each inclusion
+ * defines kernel_KS_KE_KB(). Every shift, mask and loop bound is then a
+ * constant, and direct mapped caches lose the line loops altogether,
+ * which pays even in the unoptimized build.
+ *
+ * A kernel covers the plain case only: LRU, write-back write-allocate,
+ * no lower levels and no prefetcher. init_cache_matrix() installs one
+ * when the level qualifies; anything else takes the generic path. Both
+ * keep the arena the same way, so results are identical.
+ */
+#define KERNEL_CAT(s, e, b)  kernel_##s##_##e##_##b
+#define KERNEL_NAME(s, e, b) KERNEL_CAT(s, e, b)
+
+/* Do base cache opt for a level of geometry (KS, KE, KB) */
+static void KERNEL_NAME(KS, KE, KB)(simulator_cache *sc, cache_stats *cs, cache_opt co,
+                                    cache_opt_res *optres)
+{
+    int setno = (int) ((co.addr >> KB) & ((1 << KS) - 1));
+    unsigned long long tag = co.addr >> (KS + KB);
+    unsigned int lo = (unsigned int) tag, hi = (unsigned int) (tag >> 32);
+    cache_set set;
+    int i, v = 0;
+    set_view(sc, setno, &set);
+#if KE == 1
+    i = set.stamps[0] && set.tags[0] == lo && set.tagshi[0] == hi ? 0 : -1;
+#else
+    for (i = KE - 1; i >= 0; i--) {
+        if (set.tags[i] == lo && set.tagshi[i] == hi && set.stamps[i]) break;
+    }
+#endif
+    if (i >= 0) {
+        cs->hits++;
+        *optres |= HIT;
+        set.stamps[i] = ++*set.clock;
+        if ('S' == co.opttype) set.dirty[i] = 1;
+        return;
+    }
+    cs->misses++;
+    *optres |= MISS;
+    // the LRU line, empty lines carry stamp 0.
+#if KE > 1
+    for (i = 1; i < KE; i++) {
+        if (set.stamps[i] < set.stamps[v]) v = i;
+    }
+#endif
+    if (set.stamps[v]) {
+        sc->victim = ((unsigned long long) set.tagshi[v] << 32 | set.tags[v]) << (KS + KB)
+                     | (unsigned long long) setno << KB;
+        cs->evictions++;
+        *optres |= EVICTION;
+        if (set.dirty[v]) { // write the victim back to memory.
+            cs->dirty_evictions++;
+            cs->writebacks++;
+            cs->write_bytes += 1 << KB;
+        }
+    }
+    set.tags[v] = lo;
+    set.tagshi[v] = hi;
+    set.dirty[v] = ('S' == co.opttype);
+    set.stamps[v] = ++*set.clock;
+    sc->fills++;
+}
+
+#undef KS
+#undef KE
+#undef KB
@@ -0,0 +1,127 @@
+/*
+ * csim_layout.c - Conflict-aware layout advisor. See csim_layout.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim_cli.h"
+
+/* candidate layout and its outcome */
+typedef struct layout_st {
+    int region;              // first moved region, -1 for the unpadded run
+    unsigned long long pad;  // bytes
+    unsigned long misses;
+    unsigned long evictions;
+} layout;
+
+/* Simulate the L1 of cli with regions from first on moved up by pad bytes */
+static void layout_run(csim_cli *cli, layout *lo)
+{
+    simulator_cache *sc = &cli->sc;
+    region_map *rm = cli->rg;
+    unsigned long long from = lo->region >= 0 ? rm->regions[lo->region].base : 0;
+    csim_config cfg = sc->cfg;
+    csim_stats st;
+    trace_reader tr;
+    cache_opt co;
+    csim *c;
+    int ret;
+    cfg.levels = NULL;
+    if ((ret = csim_create(&cfg, &c, NULL, 0)) < 0) {
+        fprintf(stderr, "%s", csim_strerror(ret));
+        exit(1);
+    }
+    if ((ret = trace_open(&tr, cli->tracefile, cli->tracekind)) < 0) {
+        fprintf(stderr, "%s: %s\n", cli->tracefile, trace_strerror(ret));
+        exit(1);
+    }
+    while (trace_next(&tr, &co)) {
+        if (' ' != co.inst) {
+            continue;
+        }
+        // the regions are sorted, so the moved ones are those from first on.
+        if (lo->region >= 0 && co.addr >= from && region_find(rm, co.addr) < rm->n) {
+            co.addr += lo->pad;
+        }
+        csim_access(c, co.opttype, co.addr, co.size);
+    }
+    trace_close(&tr);
+    csim_get_stats(c, 1, &st);
+    lo->misses = st.misses;
+    lo->evictions = st.evictions;
+    csim_destroy(c);
+}
+
+/* Order region pairs by mutual evictions, descending */
+static int pair_cmp(const void *a, const void *b)
+{
+    const unsigned long *x = (const unsigned long *) a, *y = (const unsigned long *) b;
+    return x[0] < y[0] ? 1 : x[0] > y[0] ? -1 : 0;
+}
+
+/* Order layouts by misses, then smaller padding */
+static int layout_cmp(const void *a, const void *b)
+{
+    const layout *x = (const layout *) a, *y = (const layout *) b;
+    if (x->misses != y->misses) return x->misses < y->misses ? -1 : 1;
+    return x->pad < y->pad ? -1 : x->pad > y->pad;
+}
+
+/* Re-simulate the L1 of csim run cli under padded layouts, print the best top */
+void layout_advise(csim_cli *cli, int top)
+{
+    simulator_cache *sc = &cli->sc;
+    region_map *rm = cli->rg;
+    int n = rm->n, npairs = 0, ncand = 0, i, j, p;
+    unsigned long (*pairs)[2] = (unsigned long (*)[2]) malloc((n * n / 2 + 1) * sizeof(*pairs));
+    layout base = {-1, 0, 0, 0}, *cands;
+    long k;
+    if (!pairs) {
+        fprintf(stderr, "Layout Memory allocation error!");
+        exit(1);
+    }
+    // the pairs of distinct regions that evict each other, {count, later region}.
+    for (i = 0; i < n; i++) {
+        for (j = i + 1; j < n; j++) {
+            pairs[npairs][0] = rm->evicts[i * (n + 1) + j] + rm->evicts[j * (n + 1) + i];
+            pairs[npairs][1] = j;
+            npairs += pairs[npairs][0] > 0;
+        }
+    }
+    qsort(pairs, npairs, sizeof(*pairs), pair_cmp);
+    if (npairs > LAYOUT_PAIRS) npairs = LAYOUT_PAIRS;
+    layout_run(cli, &base);
+    printf("layout baseline misses:%lu evictions:%lu\n", base.misses, base.evictions);
+    if (!npairs) {
+        printf("layout no conflicts between regions\n");
+        free(pairs);
+        return;
+    }
+    cands = (layout *) malloc(npairs * (LAYOUT_LINEAR + sc->s + 1) * sizeof(layout));
+    if (!cands) {
+        fprintf(stderr, "Layout Memory allocation error!");
+        exit(1);
+    }
+    for (p = 0; p < npairs; p++) {
+        for (i = 0; i < p && pairs[i][1] != pairs[p][1]; i++);
+        if (i < p) {
+            continue; // that region is padded already.
+        }
+        // 1..LAYOUT_LINEAR blocks, then powers of 2, below a full set cycle.
+        for (k = 1; k < sc->setcnt; k = k < LAYOUT_LINEAR ? k + 1 : 2 * k) {
+            cands[ncand].region = (int) pairs[p][1];
+            cands[ncand].pad = (unsigned long long) k * sc->blockcnt;
+            layout_run(cli, &cands[ncand++]);
+        }
+    }
+    qsort(cands, ncand, sizeof(layout), layout_cmp);
+    for (i = 0; i < ncand && i < top; i++) {
+        layout *lo = &cands[i];
+        printf("layout pad %s +%llu bytes (%llu blocks) misses:%lu evictions:%lu change:%+ld (%+.1f%%)\n",
+               rm->regions[lo->region].name, lo->pad, lo->pad / sc->blockcnt,
+               lo->misses, lo->evictions, (long) (lo->misses - base.misses),
+               base.misses ? 100.0 * ((double) lo->misses - base.misses) / base.misses : 0.0);
+    }
+    free(cands);
+    free(pairs);
+}
@@ -0,0 +1,26 @@
+/*
+ * csim_layout.h - Conflict-aware layout advisor behind csim -L.
+ *
+ * After a run with a region map (-r), the region pairs that evict each
+ * other most are taken one at a time, and the later region of the pair
+ * is padded: every region from it on is moved up by k blocks, as if k
+ * blocks of padding were placed in front of it. Each candidate is a full
+ * re-simulation of the L1 with the addresses of the moved regions
+ * shifted, and the layouts are ranked by misses against the unpadded
+ * run. Paddings of 1..LAYOUT_LINEAR blocks and every power of 2 blocks
+ * up to the set count are tried, which covers moving a region to any
+ * set offset when there are few sets and the usual half/quarter shifts
+ * when there are many.
+ */
+#ifndef CSIM_LAYOUT_H
+#define CSIM_LAYOUT_H
+
+#define LAYOUT_PAIRS   3   // conflicting pairs tried
+#define LAYOUT_LINEAR  8   // paddings of 1..LAYOUT_LINEAR blocks
+
+struct csim_cli_st;
+
+/* Re-simulate the L1 of csim run cli under padded layouts, print the best top */
+void layout_advise(struct csim_cli_st *cli, int top);
+
+#endif /* CSIM_LAYOUT_H */
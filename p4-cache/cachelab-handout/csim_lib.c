@@ -0,0 +1,192 @@
+/*
+ * csim_lib.c - libcsim entry points over the simulation engine.
+ * See csim_lib.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim.h"
+
+/* Parse "wb|wt[:wa|nwa]" write handling, -1 if unknown */
+int parse_write_mode(const char *arg, simulator_cache *sc)
+{
+    if (0 == strncmp(arg, "wb", 2)) {
+        sc->wthrough = 0;
+    } else if (0 == strncmp(arg, "wt", 2)) {
+        sc->wthrough = 1;
+    } else {
+        return -1;
+    }
+    arg += 2;
+    if ('\0' == *arg || 0 == strcmp(arg, ":wa")) {
+        sc->nwalloc = 0;
+    } else if (0 == strcmp(arg, ":nwa")) {
+        sc->nwalloc = 1;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/* Check a level's geometry, 0 if its set count 2^s and block size 2^b fit an int, else -1 */
+int check_geometry(int s, int E, int b)
+{
+    return s < 0 || E < 1 || b < 0 || s + b > 30 ? -1 : 0;
+}
+
+/* Apply cfg to the zeroed sc and parse its lower levels, CSIM_EINVAL/ENOMEM with a message in err */
+int csim_configure(simulator_cache *sc, const csim_config *cfg, char *err, size_t errlen)
+{
+    int kind;
+    sc->cfg = *cfg;
+    if (check_geometry(cfg->s, cfg->E, cfg->b) < 0) {
+        snprintf(err, errlen, "Bad cache geometry s=%d E=%d b=%d", cfg->s, cfg->E, cfg->b);
+        return CSIM_EINVAL;
+    }
+    sc->s = cfg->s;
+    sc->setcnt = 0x01 << sc->s;
+    sc->linecnt = sc->E = cfg->E;
+    sc->b = cfg->b;
+    sc->blockcnt = 0x01 << sc->b;
+    sc->policy = POLICY_LRU;
+    if (cfg->policy) {
+        kind = policy_parse(cfg->policy, &sc->seed);
+        if (kind < 0) {
+            snprintf(err, errlen, "Bad replacement policy %s", cfg->policy);
+            return CSIM_EINVAL;
+        }
+        sc->policy = kind;
+    }
+    if (POLICY_TREE_PLRU == sc->policy
+        && (sc->E > PLRU_MAX_WAYS || (sc->E & (sc->E - 1)))) {
+        snprintf(err, errlen, "Tree PLRU needs E to be a power of 2 up to %d", PLRU_MAX_WAYS);
+        return CSIM_EINVAL;
+    }
+    if (cfg->write && parse_write_mode(cfg->write, sc) < 0) {
+        snprintf(err, errlen, "Unknown write mode %s", cfg->write);
+        return CSIM_EINVAL;
+    }
+    sc->level = 1;
+    if (cfg->levels) {
+        return parse_hier_spec(sc, cfg->levels, err, errlen);
+    }
+    return CSIM_OK;
+}
+
+/* Create an empty cache, CSIM_OK and *out, else an error and a message in err[errlen] if err */
+int csim_create(const csim_config *cfg, csim **out, char *err, size_t errlen)
+{
+    char buf[256];
+    int ret;
+    simulator_cache *sc = (simulator_cache *) calloc(1, sizeof(simulator_cache));
+    if (!err) {
+        err = buf;
+        errlen = sizeof(buf);
+    }
+    *out = NULL;
+    if (!sc) {
+        snprintf(err, errlen, "%s", csim_strerror(CSIM_ENOMEM));
+        return CSIM_ENOMEM;
+    }
+    ret = csim_configure(sc, cfg, err, errlen);
+    if (CSIM_OK == ret && (init_cache_matrix(sc) < 0 || init_hier(sc) < 0)) {
+        snprintf(err, errlen, "%s", csim_strerror(CSIM_ENOMEM));
+        ret = CSIM_ENOMEM;
+    }
+    if (CSIM_OK != ret) {
+        csim_destroy(sc);
+        return ret;
+    }
+    *out = sc;
+    return CSIM_OK;
+}
+
+/* Access addr with op 'L', 'S' or 'M'; return CSIM_* result bits (of the load half of M) or CSIM_EINVAL */
+int csim_access(csim *c, char op, unsigned long long addr, int size)
+{
+    cache_opt co = {' ', op, size, addr};
+    cache_opt_res optres = 0, storeres = 0;
+    if ('L' != op && 'S' != op && 'M' != op) {
+        return CSIM_EINVAL;
+    }
+    do_base_opt(c, &c->cs, co, &optres);
+    if ('M' == op) { // then store it back.
+        co.opttype = 'S';
+        do_base_opt(c, &c->cs, co, &storeres);
+    }
+    return (int) (optres & (CSIM_HIT | CSIM_MISS | CSIM_EVICTION));
+}
+
+/* Run n accesses in order, CSIM_OK or CSIM_EINVAL at the first bad op, earlier ones stay done */
+int csim_access_batch(csim *c, const csim_ref *refs, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        if (c->hostpf && i + CSIM_PF_AHEAD < n) {
+            host_prefetch_set(c, refs[i + CSIM_PF_AHEAD].addr);
+        }
+        if (csim_access(c, refs[i].op, refs[i].addr, refs[i].size) < 0) {
+            return CSIM_EINVAL;
+        }
+    }
+    return CSIM_OK;
+}
+
+/* Statistics of level 1 (the L1) .. csim_levels(), CSIM_EINVAL if no such level */
+int csim_get_stats(const csim *c, int level, csim_stats *st)
+{
+    const simulator_cache *lv;
+    for (lv = c; lv && lv->level != level; lv = lv->next);
+    if (!lv) {
+        return CSIM_EINVAL;
+    }
+    st->hits = lv->cs.hits;
+    st->misses = lv->cs.misses;
+    st->evictions = lv->cs.evictions;
+    st->dirty_evictions = lv->cs.dirty_evictions;
+    st->writebacks = lv->cs.writebacks;
+    st->write_bytes = lv->cs.write_bytes;
+    return CSIM_OK;
+}
+
+/* Number of cache levels */
+int csim_levels(const csim *c)
+{
+    while (c->next) c = c->next;
+    return c->level;
+}
+
+/* Empty every level and zero the statistics, keeping the configuration */
+void csim_reset(csim *c)
+{
+    simulator_cache *lv;
+    for (lv = c; lv; lv = lv->next) {
+        reset_cache_matrix(lv);
+    }
+}
+
+/* Free the cache */
+void csim_destroy(csim *c)
+{
+    if (!c) {
+        return;
+    }
+    free_hier(c);
+    free_cache(c);
+    free(c);
+}
+
+/* Message of error code err */
+const char *csim_strerror(int err)
+{
+    switch (err) {
+    case CSIM_OK:
+        return "Success";
+    case CSIM_EINVAL:
+        return "Invalid argument";
+    case CSIM_ENOMEM:
+        return "Cache Memory allocation error!";
+    default:
+        return "Unknown error";
+    }
+}
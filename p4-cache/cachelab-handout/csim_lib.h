@@ -0,0 +1,95 @@
+/*
+ * csim_lib.h - libcsim, the cache simulator as an embeddable library.
+ *
+ * A csim handle holds one cache, with optional lower levels, and all of
+ * its state, so handles are independent and can live on different
+ * threads. No call prints or exits: failures come back as CSIM_E* codes.
+ *
+ *   csim_config cfg = {5, 1, 5, NULL, NULL, NULL};
+ *   csim *c;
+ *   csim_stats st;
+ *   if (csim_create(&cfg, &c, NULL, 0) == CSIM_OK) {
+ *       csim_access(c, 'L', 0x7ff000, 4);
+ *       csim_get_stats(c, 1, &st);
+ *       csim_destroy(c);
+ *   }
+ *
+ * Link with libcsim.a, -pthread and -lm.
+ */
+#ifndef CSIM_LIB_H
+#define CSIM_LIB_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* error codes */
+#define CSIM_OK       0
+#define CSIM_EINVAL  -1   // bad configuration or access
+#define CSIM_ENOMEM  -2   // allocation failed
+
+/* result bits of csim_access() */
+#define CSIM_HIT       0x01
+#define CSIM_MISS      0x10
+#define CSIM_EVICTION  0x100
+
+typedef struct simulator_cache_st csim;
+
+/* cache configuration, the strings take the csim -p, -w and -H syntax */
+typedef struct csim_config_st {
+    int s;               // set index bits
+    int E;               // lines per set
+    int b;               // block offset bits
+    const char *policy;  // replacement policy, NULL for lru
+    const char *write;   // write handling, NULL for wb:wa
+    const char *levels;  // lower levels, NULL for none
+} csim_config;
+
+/* statistics of one level */
+typedef struct csim_stats_st {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    unsigned long dirty_evictions;
+    unsigned long writebacks;
+    unsigned long write_bytes;
+} csim_stats;
+
+/* one data access of a batch */
+typedef struct csim_ref_st {
+    char op;                  // 'L', 'S' or 'M'
+    int size;
+    unsigned long long addr;
+} csim_ref;
+
+/* Create an empty cache, CSIM_OK and *out, else an error and a message in err[errlen] if err */
+int csim_create(const csim_config *cfg, csim **out, char *err, size_t errlen);
+
+/* Access addr with op 'L', 'S' or 'M'; return CSIM_* result bits (of the load half of M) or CSIM_EINVAL */
+int csim_access(csim *c, char op, unsigned long long addr, int size);
+
+/* Run n accesses in order, CSIM_OK or CSIM_EINVAL at the first bad op, earlier ones stay done */
+int csim_access_batch(csim *c, const csim_ref *refs, size_t n);
+
+/* Statistics of level 1 (the L1) .. csim_levels(), CSIM_EINVAL if no such level */
+int csim_get_stats(const csim *c, int level, csim_stats *st);
+
+/* Number of cache levels */
+int csim_levels(const csim *c);
+
+/* Empty every level and zero the statistics, keeping the configuration */
+void csim_reset(csim *c);
+
+/* Free the cache */
+void csim_destroy(csim *c);
+
+/* Message of error code err */
+const char *csim_strerror(int err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSIM_LIB_H */
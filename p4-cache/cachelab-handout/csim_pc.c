@@ -0,0 +1,202 @@
+/*
+ * csim_pc.c - Per-PC miss attribution. See csim_pc.h.
+ */
+#define _POSIX_C_SOURCE 200809L // popen, strdup
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim_pc.h"
+
+#define PC_MAP_MIN  1024
+
+/* Slot of key, before probing */
+static inline size_t pc_hash(unsigned long long key, size_t mask)
+{
+    return (size_t) ((key * 0x9e3779b97f4a7c15ULL) >> 17) & mask;
+}
+
+/* Parse "top[:binary[+base]]" into pp, -1 if invalid */
+int pc_profile_parse(char *arg, pc_profile *pp)
+{
+    char *end, *plus;
+    memset(pp, 0, sizeof(pc_profile));
+    pp->top = (int) strtol(arg, &end, 10);
+    if (pp->top < 1) {
+        return -1;
+    }
+    if (':' == *end) {
+        pp->binary = end + 1;
+        end = arg + strlen(arg);
+        plus = strrchr(pp->binary, '+');
+        if (plus) { // the binary name is cut at the '+'.
+            *plus = '\0';
+            pp->base = strtoull(plus + 1, &end, 0);
+        }
+    }
+    if ('\0' != *end || (pp->binary && ('\0' == *pp->binary || strchr(pp->binary, '\'')))) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Init the counters after pc_profile_parse(), 0 on success */
+int pc_profile_init(pc_profile *pp)
+{
+    pp->mask = PC_MAP_MIN - 1;
+    pp->entries = (pc_entry *) calloc(PC_MAP_MIN, sizeof(pc_entry));
+    return pp->entries ? 0 : -1;
+}
+
+/* Entry of key in entries, the empty slot where it would go if absent */
+static inline pc_entry *pc_find(pc_entry *entries, size_t mask, unsigned long long key)
+{
+    size_t h = pc_hash(key, mask);
+    while (entries[h].key && entries[h].key != key) {
+        h = (h + 1) & mask;
+    }
+    return &entries[h];
+}
+
+/* Account one demand access of the instruction at pc, 0 on success */
+int pc_profile_access(pc_profile *pp, unsigned long long pc, int miss)
+{
+    pc_entry *e;
+    if (2 * (pp->count + 1) > pp->mask + 1) { // keep the load at most 1/2.
+        size_t i, newmask = 2 * (pp->mask + 1) - 1;
+        pc_entry *entries = (pc_entry *) calloc(newmask + 1, sizeof(pc_entry));
+        if (!entries) {
+            return -1;
+        }
+        for (i = 0; i <= pp->mask; i++) {
+            if (pp->entries[i].key) *pc_find(entries, newmask, pp->entries[i].key) = pp->entries[i];
+        }
+        free(pp->entries);
+        pp->entries = entries;
+        pp->mask = newmask;
+    }
+    e = pc_find(pp->entries, pp->mask, pc + 1);
+    if (!e->key) {
+        e->key = pc + 1;
+        pp->count++;
+    }
+    e->accesses++;
+    e->misses += miss;
+    return 0;
+}
+
+/* Order entries by misses, then accesses, descending */
+static int pc_entry_cmp(const void *a, const void *b)
+{
+    const pc_entry *x = (const pc_entry *) a, *y = (const pc_entry *) b;
+    if (x->misses != y->misses) return x->misses < y->misses ? 1 : -1;
+    if (x->accesses != y->accesses) return x->accesses < y->accesses ? 1 : -1;
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+/* Order symbols by address */
+static int pc_symbol_cmp(const void *a, const void *b)
+{
+    const pc_symbol *x = (const pc_symbol *) a, *y = (const pc_symbol *) b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+/* Load the text symbols of binary with nm, return the count, -1 on error */
+static int load_symbols(const char *binary, pc_symbol **syms)
+{
+    char cmd[4096], name[1024], type;
+    unsigned long long addr, size;
+    int n = 0, cap = 0, i;
+    FILE *fp;
+    snprintf(cmd, sizeof(cmd), "nm -n -S --defined-only '%s' 2>/dev/null", binary);
+    if (!(fp = popen(cmd, "r"))) {
+        return -1;
+    }
+    *syms = NULL;
+    while (fgets(cmd, sizeof(cmd), fp)) {
+        if (4 != sscanf(cmd, "%llx %llx %c %1023s", &addr, &size, &type, name)) {
+            size = 0;
+            if (3 != sscanf(cmd, "%llx %c %1023s", &addr, &type, name)) {
+                continue;
+            }
+        }
+        if (!strchr("tTwW", type)) {
+            continue;
+        }
+        if (n == cap) {
+            pc_symbol *more = (pc_symbol *) realloc(*syms, (cap ? 2 * cap : 256) * sizeof(pc_symbol));
+            if (!more) {
+                break;
+            }
+            *syms = more;
+            cap = cap ? 2 * cap : 256;
+        }
+        (*syms)[n].addr = addr;
+        (*syms)[n].end = addr + size;
+        (*syms)[n++].name = strdup(name);
+    }
+    pclose(fp);
+    qsort(*syms, n, sizeof(pc_symbol), pc_symbol_cmp);
+    for (i = 0; i < n; i++) {
+        if ((*syms)[i].end == (*syms)[i].addr) { // unsized, the last one covers its start only.
+            (*syms)[i].end = i + 1 < n ? (*syms)[i + 1].addr : (*syms)[i].addr + 1;
+        }
+    }
+    return n;
+}
+
+/* Symbol holding addr, NULL if none does */
+static const pc_symbol *find_symbol(const pc_symbol *syms, int n, unsigned long long addr)
+{
+    int lo = 0, hi = n; // the answer is syms[lo - 1].
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (syms[mid].addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo && addr < syms[lo - 1].end ? &syms[lo - 1] : NULL;
+}
+
+/* Print the PCs with the most misses */
+void pc_profile_print(pc_profile *pp)
+{
+    pc_symbol *syms = NULL;
+    int nsyms = 0, i, top;
+    size_t j, n = 0;
+    pc_entry *sorted = (pc_entry *) malloc((pp->count + 1) * sizeof(pc_entry));
+    if (!sorted) {
+        fprintf(stderr, "PC Memory allocation error!");
+        exit(1);
+    }
+    for (j = 0; j <= pp->mask; j++) {
+        if (pp->entries[j].key) sorted[n++] = pp->entries[j];
+    }
+    qsort(sorted, n, sizeof(pc_entry), pc_entry_cmp);
+    if (pp->binary && (nsyms = load_symbols(pp->binary, &syms)) <= 0) {
+        fprintf(stderr, "%s: No symbols\n", pp->binary);
+    }
+    top = n < (size_t) pp->top ? (int) n : pp->top;
+    printf("pcs:%lu top:%d\n", (unsigned long) n, top);
+    for (i = 0; i < top; i++) {
+        unsigned long long pc = sorted[i].key - 1;
+        const pc_symbol *sym = pc < pp->base ? NULL : find_symbol(syms, nsyms, pc - pp->base);
+        printf("pc:0x%llx accesses:%lu misses:%lu miss_rate:%.4f", pc,
+               sorted[i].accesses, sorted[i].misses,
+               (double) sorted[i].misses / sorted[i].accesses);
+        if (sym) {
+            printf(" %s+0x%llx", sym->name, pc - pp->base - sym->addr);
+        }
+        printf("\n");
+    }
+    for (i = 0; i < nsyms; i++) {
+        free(syms[i].name);
+    }
+    free(syms);
+    free(sorted);
+}
+
+/* Free pc profile memory */
+void pc_profile_free(pc_profile *pp)
+{
+    free(pp->entries);
+    pp->entries = NULL;
+}
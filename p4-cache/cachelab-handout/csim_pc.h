@@ -0,0 +1,55 @@
+/*
+ * csim_pc.h - Per-PC miss attribution.
+ *
+ * Lackey writes an I record before the data records of every
+ * instruction, so the last I address is the PC of the L, S and M records
+ * that follow. Every L1 demand access is counted against that PC in a
+ * linear probing hash, and the PCs with the most misses are printed at
+ * the end, optionally as symbol+offset of the traced binary (nm -n).
+ */
+#ifndef CSIM_PC_H
+#define CSIM_PC_H
+
+#define PC_TOP_DEFAULT  10
+
+/* per-PC counters */
+typedef struct pc_entry_st {
+    unsigned long long key;   // pc + 1, 0 is an empty slot
+    unsigned long accesses;
+    unsigned long misses;
+} pc_entry;
+
+/* text symbol of the traced binary */
+typedef struct pc_symbol_st {
+    unsigned long long addr;
+    unsigned long long end;   // size from nm -S, else up to the next symbol
+    char *name;
+} pc_symbol;
+
+/* pc profile struct */
+typedef struct pc_profile_st {
+    pc_entry *entries;
+    size_t mask;               // slot count - 1
+    size_t count;
+    int top;                   // PCs printed
+
+    const char *binary;        // symbolize against it, NULL if not
+    unsigned long long base;   // load address of binary in the trace
+} pc_profile;
+
+/* Parse "top[:binary[+base]]" into pp, -1 if invalid */
+int pc_profile_parse(char *arg, pc_profile *pp);
+
+/* Init the counters after pc_profile_parse(), 0 on success */
+int pc_profile_init(pc_profile *pp);
+
+/* Account one demand access of the instruction at pc, 0 on success */
+int pc_profile_access(pc_profile *pp, unsigned long long pc, int miss);
+
+/* Print the PCs with the most misses */
+void pc_profile_print(pc_profile *pp);
+
+/* Free pc profile memory */
+void pc_profile_free(pc_profile *pp);
+
+#endif /* CSIM_PC_H */
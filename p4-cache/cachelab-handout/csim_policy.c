@@ -0,0 +1,47 @@
+/*
+ * csim_policy.c - Replacement policy names and option parsing. The
+ * policies themselves are inline in csim_policy.h.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "csim_policy.h"
+
+static const char *policy_names[POLICY_CNT] = {
+    "lru", "fifo", "random", "plru", "bitplru", "srrip", "brrip", "lfu"
+};
+
+/* Parse "name", or "name:seed" for random and brrip; return -1 if unknown or malformed */
+int policy_parse(const char *arg, unsigned long *seed)
+{
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t) (colon - arg) : strlen(arg);
+    char *end;
+    int i;
+    for (i = 0; i < POLICY_CNT; i++) {
+        if (strlen(policy_names[i]) == len && 0 == strncmp(arg, policy_names[i], len)) {
+            break;
+        }
+    }
+    if (POLICY_CNT == i) {
+        return -1;
+    }
+    if (colon) {
+        if (POLICY_RANDOM != i && POLICY_BRRIP != i) { // only these draw random numbers.
+            return -1;
+        }
+        *seed = strtoul(colon + 1, &end, 0);
+        if (end == colon + 1 || '\0' != *end || '-' == colon[1]) {
+            return -1;
+        }
+    }
+    return i;
+}
+
+/* Policy name */
+const char *policy_name(cache_policy policy)
+{
+    if (POLICY_FA_HASH == policy) {
+        return policy_names[POLICY_LRU];
+    }
+    return policy < POLICY_CNT ? policy_names[policy] : "?";
+}
@@ -0,0 +1,214 @@
+/*
+ * csim_policy.h - Replacement policies for the cache simulator.
+ *
+ * Every policy is a set of static inline hooks switched on a policy
+ * constant. do_base_opt() instantiates its body once per policy with
+ * that constant through POLICY_DISPATCH, so each copy folds down to
+ * straight-line code for one policy and the hot path makes no indirect
+ * calls.
+ *
+ * Per-line state lives in the simulator arena:
+ *   stamps  set clock at the last touch (fill only for FIFO); 0 = empty
+ *   aux     LFU use count, RRIP re-reference prediction value or MRU bit
+ * and per-set state in
+ *   bits    tree-PLRU node bits, node k (1 .. E-1) is bit k
+ *
+ * POLICY_FA_HASH is LRU for a large fully associative cache: init picks
+ * it in place of POLICY_LRU and the engine then finds lines through the
+ * hash of csim_fa.h, whose recency list also replaces the stamp scan.
+ */
+#ifndef CSIM_POLICY_H
+#define CSIM_POLICY_H
+
+#include "csim_fa.h"
+
+/* replacement policies */
+typedef enum {
+    POLICY_LRU = 0,
+    POLICY_FIFO,
+    POLICY_RANDOM,
+    POLICY_TREE_PLRU,
+    POLICY_BIT_PLRU,
+    POLICY_SRRIP,
+    POLICY_BRRIP,
+    POLICY_LFU,
+    POLICY_CNT,
+    POLICY_FA_HASH = POLICY_CNT // internal, never parsed
+} cache_policy;
+
+#define RRIP_MAX        3  // 2-bit RRPV
+#define BRRIP_LONG_ODDS 32 // BRRIP inserts at RRIP_MAX - 1 once per 32 fills
+#define PLRU_MAX_WAYS   64 // tree-PLRU node bits fit one unsigned long long
+#define FA_HASH_MIN_WAYS 64 // -s 0 LRU caches from this size use POLICY_FA_HASH
+
+/* one set's replacement state, sliced out of the simulator arena */
+typedef struct policy_set_st {
+    unsigned long *stamps;
+    unsigned int *aux;
+    unsigned long long *bits;
+    unsigned long *clock;
+    int E;
+    int setno;
+    unsigned long seed;
+    fa_lru *fa;          // POLICY_FA_HASH index
+} policy_set;
+
+/* Call fn(args..., POLICY_X) with the policy as a compile time constant */
+#define POLICY_DISPATCH(policy, fn, ...)                                    \
+    switch (policy) {                                                       \
+    case POLICY_LRU:       fn(__VA_ARGS__, POLICY_LRU); break;              \
+    case POLICY_FIFO:      fn(__VA_ARGS__, POLICY_FIFO); break;             \
+    case POLICY_RANDOM:    fn(__VA_ARGS__, POLICY_RANDOM); break;           \
+    case POLICY_TREE_PLRU: fn(__VA_ARGS__, POLICY_TREE_PLRU); break;        \
+    case POLICY_BIT_PLRU:  fn(__VA_ARGS__, POLICY_BIT_PLRU); break;         \
+    case POLICY_SRRIP:     fn(__VA_ARGS__, POLICY_SRRIP); break;            \
+    case POLICY_BRRIP:     fn(__VA_ARGS__, POLICY_BRRIP); break;            \
+    case POLICY_LFU:       fn(__VA_ARGS__, POLICY_LFU); break;              \
+    case POLICY_FA_HASH:   fn(__VA_ARGS__, POLICY_FA_HASH); break;          \
+    default: break;                                                         \
+    }
+
+/* Parse "name", or "name:seed" for random and brrip; return -1 if unknown or malformed */
+int policy_parse(const char *arg, unsigned long *seed);
+
+/* Policy name */
+const char *policy_name(cache_policy policy);
+
+/* Deterministic per-set random number, independent of thread schedule */
+static inline unsigned long policy_rand(const policy_set *ps)
+{
+    // splitmix64 over (seed, set, set clock).
+    unsigned long long z = ps->seed + 0x9e3779b97f4a7c15ULL * ((unsigned long long) ps->setno * 0x100000001ULL + *ps->clock);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (unsigned long) (z ^ (z >> 31));
+}
+
+/* Point the tree-PLRU nodes on line i's path away from it */
+static inline void plru_tree_touch(policy_set *ps, int i)
+{
+    unsigned long long bits = *ps->bits;
+    int node = 1, k;
+    for (k = ps->E >> 1; k; k >>= 1) {
+        int right = (i & k) != 0;
+        if (right) bits &= ~(1ULL << node); // 0 points left, away from us.
+        else bits |= 1ULL << node;
+        node = node * 2 + right;
+    }
+    *ps->bits = bits;
+}
+
+/* Mark line i recently used, clear the others once all are marked */
+static inline void plru_bit_touch(policy_set *ps, int i)
+{
+    int j;
+    ps->aux[i] = 1;
+    for (j = 0; j < ps->E; j++) {
+        if (!ps->aux[j]) return;
+    }
+    for (j = 0; j < ps->E; j++) {
+        ps->aux[j] = (j == i);
+    }
+}
+
+/* Update replacement state on a hit to line i */
+static inline void policy_touch(policy_set *ps, int i, const cache_policy policy)
+{
+    if (POLICY_FIFO != policy) {
+        ps->stamps[i] = ++*ps->clock;
+    } else {
+        ++*ps->clock;
+    }
+    switch (policy) {
+    case POLICY_TREE_PLRU: plru_tree_touch(ps, i); break;
+    case POLICY_BIT_PLRU:  plru_bit_touch(ps, i); break;
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:     ps->aux[i] = 0; break;
+    case POLICY_LFU:       if (ps->aux[i] + 1) ps->aux[i]++; break;
+    case POLICY_FA_HASH:   fa_lru_touch(ps->fa, i); break;
+    default: break;
+    }
+}
+
+/* Update replacement state after line i was filled */
+static inline void policy_fill(policy_set *ps, int i, const cache_policy policy)
+{
+    ps->stamps[i] = ++*ps->clock;
+    switch (policy) {
+    case POLICY_TREE_PLRU: plru_tree_touch(ps, i); break;
+    case POLICY_BIT_PLRU:  plru_bit_touch(ps, i); break;
+    case POLICY_SRRIP:     ps->aux[i] = RRIP_MAX - 1; break;
+    case POLICY_BRRIP:
+        ps->aux[i] = policy_rand(ps) % BRRIP_LONG_ODDS ? RRIP_MAX : RRIP_MAX - 1;
+        break;
+    case POLICY_LFU:       ps->aux[i] = 1; break;
+    default: break;
+    }
+}
+
+/* Pick the line to fill, an empty one if any, else the policy's victim */
+static inline int policy_victim(policy_set *ps, const cache_policy policy)
+{
+    const unsigned long *stamps = ps->stamps;
+    int E = ps->E;
+    int i, v = 0;
+    if (POLICY_FA_HASH == policy) {
+        return fa_lru_victim(ps->fa);
+    }
+    if (POLICY_LRU == policy || POLICY_FIFO == policy) {
+        // empty lines carry stamp 0, so the oldest stamp covers them too.
+        unsigned long minstamp = stamps[0];
+        for (i = 1; i < E && minstamp; i++) {
+            if (stamps[i] < minstamp) {
+                v = i;
+                minstamp = stamps[i];
+            }
+        }
+        return v;
+    }
+    for (i = 0; i < E; i++) {
+        if (!stamps[i]) return i;
+    }
+    switch (policy) {
+    case POLICY_RANDOM:
+        return (int) (policy_rand(ps) % E);
+    case POLICY_TREE_PLRU: {
+        unsigned long long bits = *ps->bits;
+        int node = 1, k;
+        for (k = E >> 1; k; k >>= 1) {
+            int right = (bits >> node) & 1;
+            v |= right ? k : 0;
+            node = node * 2 + right;
+        }
+        return v;
+    }
+    case POLICY_BIT_PLRU:
+        for (i = 0; i < E; i++) {
+            if (!ps->aux[i]) return i;
+        }
+        return 0;
+    case POLICY_SRRIP:
+    case POLICY_BRRIP:
+        for (;;) {
+            for (i = 0; i < E; i++) {
+                if (RRIP_MAX == ps->aux[i]) return i;
+            }
+            for (i = 0; i < E; i++) {
+                ps->aux[i]++;
+            }
+        }
+    case POLICY_LFU:
+        // fewest uses, least recently used among equals.
+        for (i = 1; i < E; i++) {
+            if (ps->aux[i] < ps->aux[v]
+                || (ps->aux[i] == ps->aux[v] && stamps[i] < stamps[v])) {
+                v = i;
+            }
+        }
+        return v;
+    default:
+        return 0;
+    }
+}
+
+#endif /* CSIM_POLICY_H */
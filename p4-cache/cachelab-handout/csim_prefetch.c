@@ -0,0 +1,190 @@
+/*
+ * csim_prefetch.c - Next-line, stream and per-PC stride prefetchers.
+ * See csim_prefetch.h for the trigger and classification rules.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim.h"
+
+static const char *pf_names[PF_CNT] = {"next", "stream", "stride"};
+
+/* Parse "kind[:degree[:distance]]" into pf, -1 if invalid */
+int prefetch_parse(const char *arg, prefetcher *pf)
+{
+    const char *colon = strchr(arg, ':');
+    size_t len = colon ? (size_t) (colon - arg) : strlen(arg);
+    char *end;
+    int i;
+    memset(pf, 0, sizeof(prefetcher));
+    pf->kind = PF_CNT;
+    for (i = 0; i < PF_CNT; i++) {
+        if (strlen(pf_names[i]) == len && 0 == strncmp(arg, pf_names[i], len)) {
+            pf->kind = i;
+        }
+    }
+    if (PF_CNT == pf->kind) {
+        return -1;
+    }
+    pf->degree = pf->distance = 1;
+    if (colon) {
+        pf->degree = (int) strtol(colon + 1, &end, 10);
+        if (':' == *end) {
+            pf->distance = (int) strtol(end + 1, &end, 10);
+        }
+        if ('\0' != *end) {
+            return -1;
+        }
+    }
+    if (pf->degree < 1 || pf->degree > PF_MAX_DEGREE
+        || pf->distance < 1 || pf->distance > PF_MAX_DISTANCE) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Prefetch block into L1 and remember when it lands */
+static void issue(simulator_cache *sc, unsigned long block)
+{
+    prefetcher *pf = sc->pf;
+    if (!prefetch_line(sc, (unsigned long long) block << sc->b)) {
+        return; // already cached.
+    }
+    pf->issued++;
+    pf->flight[pf->nflight % PF_INFLIGHT].block = block;
+    pf->flight[pf->nflight % PF_INFLIGHT].ready = pf->now + PF_LATENCY;
+    pf->nflight++;
+}
+
+/* Follow or start the stream block belongs to */
+static void stream_access(simulator_cache *sc, unsigned long block)
+{
+    prefetcher *pf = sc->pf;
+    pf_stream *st = NULL, *lru = &pf->streams[0];
+    int i, k, dir;
+    for (i = 0; i < PF_STREAMS; i++) {
+        pf_stream *cand = &pf->streams[i];
+        long delta = (long) (block - cand->last);
+        if (cand->used && delta >= -PF_WINDOW && delta <= PF_WINDOW) {
+            st = cand;
+            break;
+        }
+        if (cand->used < lru->used) {
+            lru = cand;
+        }
+    }
+    if (!st) { // a new stream, needs two more misses to confirm.
+        lru->last = block;
+        lru->dir = lru->conf = 0;
+        lru->used = pf->now;
+        return;
+    }
+    st->used = pf->now;
+    if (block == st->last) {
+        return;
+    }
+    dir = block > st->last ? 1 : -1;
+    if (dir == st->dir) {
+        if (st->conf < 2) st->conf++;
+    } else {
+        st->dir = dir;
+        st->conf = 1;
+    }
+    st->last = block;
+    if (st->conf < 2) {
+        return;
+    }
+    for (k = 0; k < pf->degree; k++) {
+        issue(sc, block + (long) dir * (pf->distance + k));
+    }
+}
+
+/* Train the PC's stride entry and prefetch along a confirmed stride */
+static void stride_access(simulator_cache *sc, unsigned long long addr, int trigger)
+{
+    prefetcher *pf = sc->pf;
+    pf_stride *e = &pf->strides[(sc->pc ^ (sc->pc >> 8)) % PF_STRIDE_ENTRIES];
+    long long step, delta;
+    int k;
+    if (e->pc != sc->pc) {
+        e->pc = sc->pc;
+        e->lastaddr = addr;
+        e->stride = e->conf = 0;
+        return;
+    }
+    delta = (long long) (addr - e->lastaddr);
+    if (0 == delta) { // e.g. the store half of M.
+        return;
+    }
+    if (delta == e->stride) {
+        if (e->conf < 2) e->conf++;
+    } else {
+        e->stride = delta;
+        e->conf = 0;
+    }
+    e->lastaddr = addr;
+    if (!trigger || e->conf < 2) {
+        return;
+    }
+    // strides under a block advance a block at a time.
+    step = e->stride;
+    if (step > -sc->blockcnt && step < sc->blockcnt) {
+        step = step > 0 ? sc->blockcnt : -sc->blockcnt;
+    }
+    for (k = 0; k < pf->degree; k++) {
+        issue(sc, (addr + step * (pf->distance + k)) >> sc->b);
+    }
+}
+
+/* Observe one L1 demand access to addr and prefetch if triggered */
+void prefetch_access(simulator_cache *sc, unsigned long long addr, int trigger)
+{
+    prefetcher *pf = sc->pf;
+    unsigned long block = addr >> sc->b;
+    int k;
+    pf->now++;
+    switch (pf->kind) {
+    case PF_NEXT:
+        if (trigger) {
+            for (k = 0; k < pf->degree; k++) {
+                issue(sc, block + pf->distance + k);
+            }
+        }
+        break;
+    case PF_STREAM:
+        if (trigger) {
+            stream_access(sc, block);
+        }
+        break;
+    case PF_STRIDE:
+        stride_access(sc, addr, trigger);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Return 1 if the prefetch of block is still in flight */
+int prefetch_late(prefetcher *pf, unsigned long block)
+{
+    unsigned long n;
+    // newest first, ready times only grow with issue order.
+    for (n = pf->nflight; n > 0 && pf->nflight - n < PF_INFLIGHT; n--) {
+        pf_flight *f = &pf->flight[(n - 1) % PF_INFLIGHT];
+        if (f->ready <= pf->now) {
+            return 0;
+        }
+        if (f->block == block) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Print prefetch statistics */
+void prefetch_print(prefetcher *pf)
+{
+    printf("prefetch (%s degree=%d distance=%d) issued:%lu useful:%lu late:%lu polluting:%lu\n",
+           pf_names[pf->kind], pf->degree, pf->distance,
+           pf->issued, pf->useful, pf->late, pf->polluting);
+}
@@ -0,0 +1,89 @@
+/*
+ * csim_prefetch.h - Hardware prefetcher models for the L1 cache.
+ *
+ * A prefetcher watches the L1 demand stream and is triggered by a demand
+ * miss or by the first demand use of a prefetched line, so a stream that
+ * is covered keeps running ahead. Prefetched blocks are filled like
+ * demand blocks but flagged, which lets the simulator classify each one:
+ *
+ *   useful     first demand use came after the block landed
+ *   late       first demand use came while it was still in flight
+ *   polluting  evicted without ever being used
+ *
+ * Prefetches take PF_LATENCY demand accesses to land. Hits and misses
+ * stay demand only, but lines a prefetch evicts count as evictions.
+ */
+#ifndef CSIM_PREFETCH_H
+#define CSIM_PREFETCH_H
+
+/* prefetcher kinds */
+typedef enum {
+    PF_NEXT = 0, // next-line: blocks B + distance ...
+    PF_STREAM,   // stream: confirmed ascending/descending block streams
+    PF_STRIDE,   // per-PC stride, PC taken from the preceding I record
+    PF_CNT
+} pf_kind;
+
+#define PF_STREAMS        16  // stream table entries
+#define PF_WINDOW         16  // blocks a miss may be from a stream to join it
+#define PF_STRIDE_ENTRIES 256 // per-PC table entries, direct mapped
+#define PF_INFLIGHT       256 // prefetches remembered for lateness
+#define PF_LATENCY        16  // demand accesses until a prefetch lands
+#define PF_MAX_DEGREE     16
+#define PF_MAX_DISTANCE   64
+
+/* stream table entry */
+typedef struct pf_stream_st {
+    unsigned long last; // last block seen
+    int dir;            // +1, -1 or 0 while unconfirmed
+    int conf;
+    unsigned long used; // prefetcher clock at the last update
+} pf_stream;
+
+/* stride table entry */
+typedef struct pf_stride_st {
+    unsigned long long pc;
+    unsigned long long lastaddr;
+    long long stride;
+    int conf;
+} pf_stride;
+
+/* prefetch in flight */
+typedef struct pf_flight_st {
+    unsigned long block;
+    unsigned long ready; // prefetcher clock when it lands
+} pf_flight;
+
+/* prefetcher struct */
+typedef struct prefetcher_st {
+    pf_kind kind;
+    int degree;   // blocks issued per trigger
+    int distance; // how far ahead the first one is, in blocks (strides)
+    unsigned long now; // demand accesses seen
+
+    pf_stream streams[PF_STREAMS];
+    pf_stride strides[PF_STRIDE_ENTRIES];
+    pf_flight flight[PF_INFLIGHT];
+    unsigned long nflight;
+
+    unsigned long issued;
+    unsigned long useful;
+    unsigned long late;
+    unsigned long polluting;
+} prefetcher;
+
+struct simulator_cache_st;
+
+/* Parse "kind[:degree[:distance]]" into pf, -1 if invalid */
+int prefetch_parse(const char *arg, prefetcher *pf);
+
+/* Observe one L1 demand access to addr and prefetch if triggered */
+void prefetch_access(struct simulator_cache_st *sc, unsigned long long addr, int trigger);
+
+/* Return 1 if the prefetch of block is still in flight */
+int prefetch_late(prefetcher *pf, unsigned long block);
+
+/* Print prefetch statistics */
+void prefetch_print(prefetcher *pf);
+
+#endif /* CSIM_PREFETCH_H */
@@ -0,0 +1,168 @@
+/*
+ * csim_region.c - Per-region attribution of L1 outcomes. See csim_region.h.
+ */
+#define _POSIX_C_SOURCE 200809L // strdup
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim_region.h"
+
+/* Order regions by base */
+static int region_cmp(const void *a, const void *b)
+{
+    const region *x = (const region *) a, *y = (const region *) b;
+    return x->base < y->base ? -1 : x->base > y->base;
+}
+
+/* Load region map file path, 0 on success, -1 with a message on error */
+int region_map_load(region_map *rm, const char *path)
+{
+    char line[1024], name[256], base[64], len[64];
+    int lineno = 0, i;
+    FILE *fp = fopen(path, "r");
+    memset(rm, 0, sizeof(region_map));
+    if (!fp) {
+        fprintf(stderr, "%s: No such file or directory\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *hash = strchr(line, '#'), *end1, *end2;
+        region *r = &rm->regions[rm->n];
+        lineno++;
+        if (hash) *hash = '\0';
+        if (sscanf(line, "%255s", name) != 1) {
+            continue; // blank or comment.
+        }
+        if (3 != sscanf(line, "%255s %63s %63s", name, base, len)) {
+            fprintf(stderr, "%s:%d: expected name base length\n", path, lineno);
+            fclose(fp);
+            return -1;
+        }
+        r->base = strtoull(base, &end1, 0);
+        r->len = strtoull(len, &end2, 0);
+        if ('\0' != *end1 || '\0' != *end2 || 0 == r->len || rm->n == REGION_MAX) {
+            fprintf(stderr, "%s:%d: bad region %s\n", path, lineno, name);
+            fclose(fp);
+            return -1;
+        }
+        r->name = strdup(name);
+        rm->n++;
+    }
+    fclose(fp);
+    qsort(rm->regions, rm->n, sizeof(region), region_cmp);
+    for (i = 1; i < rm->n; i++) {
+        if (rm->regions[i].base < rm->regions[i - 1].base + rm->regions[i - 1].len) {
+            fprintf(stderr, "%s: regions %s and %s overlap\n", path,
+                    rm->regions[i - 1].name, rm->regions[i].name);
+            return -1;
+        }
+    }
+    rm->regions[rm->n].name = "(other)";
+    rm->evicts = (unsigned long *) calloc((rm->n + 1) * (rm->n + 1), sizeof(unsigned long));
+    if (!rm->evicts) {
+        fprintf(stderr, "Region Memory allocation error!");
+        return -1;
+    }
+    return 0;
+}
+
+/* Index of the region holding addr, n if none */
+int region_find(const region_map *rm, unsigned long long addr)
+{
+    int lo = 0, hi = rm->n; // the candidate is regions[lo - 1].
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (rm->regions[mid].base <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo && addr - rm->regions[lo - 1].base < rm->regions[lo - 1].len) {
+        return lo - 1;
+    }
+    return rm->n;
+}
+
+/* Account one demand access to addr, evicting victim if evicted */
+void region_map_access(region_map *rm, unsigned long long addr, int hit, int evicted,
+                       unsigned long long victim)
+{
+    int i = region_find(rm, addr);
+    region *r = &rm->regions[i];
+    if (hit) {
+        r->hits++;
+    } else {
+        r->misses++;
+    }
+    if (evicted) {
+        r->evictions++;
+        rm->evicts[i * (rm->n + 1) + region_find(rm, victim)]++;
+    }
+}
+
+/* Mark the sets region r maps to in sets, return their count */
+static int region_sets(const region *r, int s, int b, unsigned char *sets)
+{
+    unsigned long long first = r->base >> b, last = (r->base + r->len - 1) >> b, blk;
+    unsigned long long setcnt = 1ULL << s;
+    int cnt = 0;
+    memset(sets, 0, setcnt);
+    // blocks past setcnt wrap onto sets already marked.
+    for (blk = first; blk <= last && blk - first < setcnt; blk++) {
+        cnt += !sets[blk & (setcnt - 1)];
+        sets[blk & (setcnt - 1)] = 1;
+    }
+    return cnt;
+}
+
+/* Print per-region counters, eviction pairs and set aliasing for s and b */
+void region_map_print(region_map *rm, int s, int b)
+{
+    int i, j, k, setcnt = 1 << s;
+    unsigned char *si = (unsigned char *) malloc(setcnt), *sj = (unsigned char *) malloc(setcnt);
+    if (!si || !sj) {
+        fprintf(stderr, "Region Memory allocation error!");
+        exit(1);
+    }
+    for (i = 0; i <= rm->n; i++) {
+        region *r = &rm->regions[i];
+        if (i == rm->n && !r->hits && !r->misses) {
+            continue;
+        }
+        printf("region %s", r->name);
+        if (i < rm->n) {
+            printf(" base:0x%llx len:%llu sets:%d", r->base, r->len, region_sets(r, s, b, si));
+        }
+        printf(" hits:%lu misses:%lu evictions:%lu\n", r->hits, r->misses, r->evictions);
+    }
+    for (i = 0; i <= rm->n; i++) {
+        for (j = 0; j <= rm->n; j++) {
+            unsigned long cnt = rm->evicts[i * (rm->n + 1) + j];
+            if (cnt) {
+                printf("conflict %s evicts %s:%lu\n", rm->regions[i].name, rm->regions[j].name, cnt);
+            }
+        }
+    }
+    for (i = 0; i < rm->n; i++) {
+        region_sets(&rm->regions[i], s, b, si);
+        for (j = i + 1; j < rm->n; j++) {
+            int shared = 0;
+            region_sets(&rm->regions[j], s, b, sj);
+            for (k = 0; k < setcnt; k++) {
+                shared += si[k] & sj[k];
+            }
+            printf("alias %s %s sets:%d/%d\n", rm->regions[i].name, rm->regions[j].name, shared, setcnt);
+        }
+    }
+    free(si);
+    free(sj);
+}
+
+/* Free region map memory */
+void region_map_free(region_map *rm)
+{
+    int i;
+    for (i = 0; i < rm->n; i++) {
+        free(rm->regions[i].name);
+    }
+    free(rm->evicts);
+    memset(rm, 0, sizeof(region_map));
+}
@@ -0,0 +1,49 @@
+/*
+ * csim_region.h - Per-region attribution of L1 outcomes.
+ *
+ * A region map file names address ranges, one "name base length" per
+ * line (base and length in C notation, # starts a comment); tracegen
+ * writes one for A and B to .regions. Every L1 demand access is counted
+ * against the region holding it, every eviction against the pair of the
+ * accessing and the victim region, and each pair of regions is checked
+ * for the cache sets both of them map to.
+ */
+#ifndef CSIM_REGION_H
+#define CSIM_REGION_H
+
+#define REGION_MAX  64
+
+/* named address range and its counters */
+typedef struct region_st {
+    char *name;
+    unsigned long long base;
+    unsigned long long len;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+} region;
+
+/* region map struct, region n is everything outside the map */
+typedef struct region_map_st {
+    region regions[REGION_MAX + 1];
+    int n;
+    unsigned long *evicts;   // (n + 1) x (n + 1), [accessor][victim]
+} region_map;
+
+/* Load region map file path, 0 on success, -1 with a message on error */
+int region_map_load(region_map *rm, const char *path);
+
+/* Index of the region holding addr, n if none */
+int region_find(const region_map *rm, unsigned long long addr);
+
+/* Account one demand access to addr, evicting victim if evicted */
+void region_map_access(region_map *rm, unsigned long long addr, int hit, int evicted,
+                       unsigned long long victim);
+
+/* Print per-region counters, eviction pairs and set aliasing for s and b */
+void region_map_print(region_map *rm, int s, int b);
+
+/* Free region map memory */
+void region_map_free(region_map *rm);
+
+#endif /* CSIM_REGION_H */
@@ -0,0 +1,468 @@
+/*
+ * csim_reuse.c - Reuse distance and time distance histograms.
+ * See csim_reuse.h for the method.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "csim_reuse.h"
+
+#define REUSE_MAP_MIN  1024
+
+/* Slot of block in the map, before probing */
+static inline size_t reuse_hash(unsigned long long block, size_t mask)
+{
+    return (size_t) ((block * 0x9e3779b97f4a7c15ULL) >> 17) & mask;
+}
+
+/* Histogram bin of distance d */
+static inline int reuse_bin(unsigned long long d)
+{
+    return d ? 64 - __builtin_clzll(d) : 0;
+}
+
+/* Add delta at slot i of the Fenwick tree */
+static inline void fenwick_add(reuse_profile *rp, size_t i, int delta)
+{
+    size_t x;
+    for (x = i + 1; x <= rp->cap; x += x & (0 - x)) {
+        rp->tree[x] += delta;
+    }
+}
+
+/* Sum of slots 0..i of the Fenwick tree */
+static inline unsigned long fenwick_sum(reuse_profile *rp, size_t i)
+{
+    unsigned long sum = 0;
+    size_t x;
+    for (x = i + 1; x > 0; x -= x & (0 - x)) {
+        sum += rp->tree[x];
+    }
+    return sum;
+}
+
+/* Map entry of block, the empty slot where it would go if absent */
+static inline size_t reuse_find(reuse_profile *rp, unsigned long long block)
+{
+    size_t h = reuse_hash(block, rp->mask);
+    while (rp->keys[h] && rp->keys[h] != block + 1) {
+        h = (h + 1) & rp->mask;
+    }
+    return h;
+}
+
+/* Remove map entry h, shifting its probe run back over it */
+static void reuse_map_delete(reuse_profile *rp, size_t h)
+{
+    size_t j = h, k;
+    for (;;) {
+        j = (j + 1) & rp->mask;
+        if (!rp->keys[j]) {
+            break;
+        }
+        k = reuse_hash(rp->keys[j] - 1, rp->mask);
+        // move j back to h unless its home slot k lies cyclically in (h, j].
+        if ((h < j) ? (k <= h || k > j) : (k <= h && k > j)) {
+            rp->keys[h] = rp->keys[j];
+            rp->slots[h] = rp->slots[j];
+            rp->times[h] = rp->times[j];
+            h = j;
+        }
+    }
+    rp->keys[h] = 0;
+    rp->count--;
+}
+
+/* Double the map, 0 on success */
+static int reuse_grow_map(reuse_profile *rp)
+{
+    size_t oldmask = rp->mask, i;
+    unsigned long long *keys = rp->keys, *times = rp->times;
+    size_t *slots = rp->slots;
+    rp->mask = 2 * (oldmask + 1) - 1;
+    rp->keys = (unsigned long long *) calloc(rp->mask + 1, sizeof(unsigned long long));
+    rp->slots = (size_t *) malloc((rp->mask + 1) * sizeof(size_t));
+    rp->times = (unsigned long long *) malloc((rp->mask + 1) * sizeof(unsigned long long));
+    if (!rp->keys || !rp->slots || !rp->times) {
+        return -1;
+    }
+    for (i = 0; i <= oldmask; i++) {
+        if (keys[i]) {
+            size_t h = reuse_find(rp, keys[i] - 1);
+            rp->keys[h] = keys[i];
+            rp->slots[h] = slots[i];
+            rp->times[h] = times[i];
+        }
+    }
+    free(keys);
+    free(slots);
+    free(times);
+    return 0;
+}
+
+/* Move the live slots to the front, growing the tree if they fill half, 0 on success */
+static int reuse_compact(reuse_profile *rp)
+{
+    size_t i, j = 0, x;
+    for (i = 0; i < rp->now; i++) { // j <= i, so owner can be rewritten in place.
+        size_t h = reuse_find(rp, rp->owner[i]);
+        if (rp->keys[h] && rp->slots[h] == i) { // dropped blocks are dead.
+            rp->owner[j] = rp->owner[i];
+            rp->slots[h] = j++;
+        }
+    }
+    rp->now = j;
+    if (2 * j > rp->cap) {
+        int *tree = (int *) realloc(rp->tree, (2 * rp->cap + 1) * sizeof(int));
+        unsigned long long *owner = (unsigned long long *) realloc(rp->owner, 2 * rp->cap * sizeof(unsigned long long));
+        if (tree) rp->tree = tree;
+        if (owner) rp->owner = owner;
+        if (!tree || !owner) {
+            return -1;
+        }
+        rp->cap *= 2;
+    }
+    // rebuild: every slot below j is marked.
+    memset(rp->tree, 0, (rp->cap + 1) * sizeof(int));
+    for (x = 1; x <= rp->cap; x++) {
+        size_t parent = x + (x & (0 - x));
+        rp->tree[x] += x <= j;
+        if (parent <= rp->cap) {
+            rp->tree[parent] += rp->tree[x];
+        }
+    }
+    return 0;
+}
+
+/* Init reuse profile for blocks of 2^b bytes with cap access slots, 0 on success */
+static int reuse_init(reuse_profile *rp, int b, size_t cap)
+{
+    memset(rp, 0, sizeof(*rp));
+    rp->b = b;
+    rp->cap = cap;
+    rp->tree = (int *) calloc(rp->cap + 1, sizeof(int));
+    rp->owner = (unsigned long long *) malloc(rp->cap * sizeof(unsigned long long));
+    rp->mask = REUSE_MAP_MIN - 1;
+    rp->keys = (unsigned long long *) calloc(REUSE_MAP_MIN, sizeof(unsigned long long));
+    rp->slots = (size_t *) malloc(REUSE_MAP_MIN * sizeof(size_t));
+    rp->times = (unsigned long long *) malloc(REUSE_MAP_MIN * sizeof(unsigned long long));
+    if (!rp->tree || !rp->owner || !rp->keys || !rp->slots || !rp->times) {
+        reuse_profile_free(rp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Init reuse profile for blocks of 2^b bytes, 0 on success */
+int reuse_profile_init(reuse_profile *rp, int b)
+{
+    return reuse_init(rp, b, REUSE_MIN_CAP);
+}
+
+/* Touch block, 1 and its reuse and time distances if seen before, 0 if cold, -1 on allocation error */
+int reuse_touch(reuse_profile *rp, unsigned long long block, unsigned long long *d, unsigned long long *td)
+{
+    int reused;
+    size_t h;
+    if (rp->now == rp->cap && reuse_compact(rp) < 0) {
+        return -1;
+    }
+    if (2 * (rp->count + 1) > rp->mask + 1 && reuse_grow_map(rp) < 0) {
+        return -1;
+    }
+    h = reuse_find(rp, block);
+    reused = rp->keys[h] != 0;
+    if (reused) {
+        size_t last = rp->slots[h];
+        // distinct blocks whose latest access lies after ours.
+        *d = fenwick_sum(rp, rp->now - 1) - fenwick_sum(rp, last);
+        *td = rp->clock - rp->times[h];
+        fenwick_add(rp, last, -1);
+    } else {
+        rp->keys[h] = block + 1;
+        rp->count++;
+    }
+    rp->slots[h] = rp->now;
+    rp->times[h] = rp->clock++;
+    rp->owner[rp->now] = block;
+    fenwick_add(rp, rp->now++, 1);
+    return reused;
+}
+
+/* Forget block, as if it was never touched */
+void reuse_drop(reuse_profile *rp, unsigned long long block)
+{
+    size_t h = reuse_find(rp, block);
+    if (rp->keys[h]) {
+        fenwick_add(rp, rp->slots[h], -1);
+        reuse_map_delete(rp, h);
+    }
+}
+
+/* Account one access to addr, 0 on success */
+int reuse_profile_access(reuse_profile *rp, unsigned long long addr, int store)
+{
+    unsigned long long d, td;
+    int reused = reuse_touch(rp, addr >> rp->b, &d, &td);
+    if (reused < 0) {
+        return -1;
+    }
+    if (reused) {
+        rp->rdhist[store][reuse_bin(d)]++;
+        rp->tdhist[store][reuse_bin(td)]++;
+    } else {
+        rp->cold[store]++;
+    }
+    return 0;
+}
+
+/* Print bins 0..maxbin of one histogram pair */
+static void reuse_print_hist(const char *name, unsigned long hist[2][REUSE_BINS])
+{
+    int k, maxbin = 0;
+    for (k = 0; k < REUSE_BINS; k++) {
+        if (hist[0][k] || hist[1][k]) maxbin = k;
+    }
+    for (k = 0; k <= maxbin; k++) {
+        unsigned long long lo = k ? 1ULL << (k - 1) : 0;
+        unsigned long long hi = k ? (1ULL << (k - 1)) * 2 - 1 : 0;
+        if (lo == hi) {
+            printf("%s=%llu loads:%lu stores:%lu\n", name, lo, hist[0][k], hist[1][k]);
+        } else {
+            printf("%s=%llu-%llu loads:%lu stores:%lu\n", name, lo, hi, hist[0][k], hist[1][k]);
+        }
+    }
+}
+
+/* Print both histograms and the LRU miss count of every power of 2 size */
+void reuse_profile_print(reuse_profile *rp)
+{
+    unsigned long misses;
+    int j, k, maxbin = 0;
+    printf("reuse cold loads:%lu stores:%lu\n", rp->cold[0], rp->cold[1]);
+    reuse_print_hist("rd", rp->rdhist);
+    reuse_print_hist("td", rp->tdhist);
+    // a fully associative LRU cache of 2^j lines misses on distances >= 2^j.
+    for (k = 0; k < REUSE_BINS; k++) {
+        if (rp->rdhist[0][k] || rp->rdhist[1][k]) maxbin = k;
+    }
+    for (j = 0; j < maxbin; j++) {
+        misses = rp->cold[0] + rp->cold[1];
+        for (k = j + 1; k < REUSE_BINS; k++) {
+            misses += rp->rdhist[0][k] + rp->rdhist[1][k];
+        }
+        printf("lru lines=%lu misses:%lu\n", 1UL << j, misses);
+    }
+}
+
+/* Free reuse profile memory */
+void reuse_profile_free(reuse_profile *rp)
+{
+    free(rp->tree);
+    free(rp->owner);
+    free(rp->keys);
+    free(rp->slots);
+    free(rp->times);
+    memset(rp, 0, sizeof(*rp));
+}
+
+/* Sampling hash of block, uniform over [0, SHARDS_P) */
+static inline unsigned int shards_hash(unsigned long long block)
+{
+    block ^= block >> 33;
+    block *= 0xff51afd7ed558ccdULL;
+    block ^= block >> 33;
+    block *= 0xc4ceb9fe1a85ec53ULL;
+    block ^= block >> 33;
+    return (unsigned int) (block & (SHARDS_P - 1));
+}
+
+/* Parse "rate[:blocks]" sampling options, -1 if invalid */
+int shards_parse(const char *arg, double *rate, int *smax)
+{
+    char *end;
+    *rate = strtod(arg, &end);
+    *smax = SHARDS_SMAX;
+    if (':' == *end) {
+        *smax = (int) strtol(end + 1, &end, 10);
+    }
+    if ('\0' != *end || !(*rate > 0 && *rate <= 1) || *smax < 1) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Init sampler of blocks of 2^b bytes at rate, tracking at most smax blocks, 0 on success */
+int shards_init(shards_profile *sh, double rate, int smax, int b)
+{
+    int g;
+    memset(sh, 0, sizeof(*sh));
+    sh->b = b;
+    sh->smax = smax;
+    sh->threshold = (unsigned int) (rate * SHARDS_P);
+    if (sh->threshold < 1) sh->threshold = 1;
+    sh->rate0 = (double) sh->threshold / SHARDS_P;
+    sh->heaphash = (unsigned int *) malloc((smax + 1) * sizeof(unsigned int));
+    sh->heapblock = (unsigned long long *) malloc((smax + 1) * sizeof(unsigned long long));
+    if (!sh->heaphash || !sh->heapblock || reuse_profile_init(&sh->rp, b) < 0) {
+        shards_free(sh);
+        return -1;
+    }
+    for (g = 0; g < SHARDS_GROUPS; g++) {
+        if (reuse_init(&sh->grp[g], b, REUSE_MIN_CAP / SHARDS_GROUPS) < 0) {
+            shards_free(sh);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Swap heap entries i and j */
+static inline void heap_swap(shards_profile *sh, int i, int j)
+{
+    unsigned int th = sh->heaphash[i];
+    unsigned long long tb = sh->heapblock[i];
+    sh->heaphash[i] = sh->heaphash[j];
+    sh->heapblock[i] = sh->heapblock[j];
+    sh->heaphash[j] = th;
+    sh->heapblock[j] = tb;
+}
+
+/* Push a newly tracked block on the max-heap of sampling hashes */
+static void heap_push(shards_profile *sh, unsigned int hash, unsigned long long block)
+{
+    int i = sh->heapn++;
+    sh->heaphash[i] = hash;
+    sh->heapblock[i] = block;
+    while (i > 0 && sh->heaphash[(i - 1) / 2] < sh->heaphash[i]) {
+        heap_swap(sh, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/* Pop the tracked block with the largest sampling hash */
+static unsigned long long heap_pop(shards_profile *sh)
+{
+    unsigned long long block = sh->heapblock[0];
+    int i = 0, c;
+    sh->heapn--;
+    sh->heaphash[0] = sh->heaphash[sh->heapn];
+    sh->heapblock[0] = sh->heapblock[sh->heapn];
+    while ((c = 2 * i + 1) < sh->heapn) {
+        if (c + 1 < sh->heapn && sh->heaphash[c + 1] > sh->heaphash[c]) c++;
+        if (sh->heaphash[c] <= sh->heaphash[i]) {
+            break;
+        }
+        heap_swap(sh, i, c);
+        i = c;
+    }
+    return block;
+}
+
+/* Account one access to addr, 0 on success */
+int shards_access(shards_profile *sh, unsigned long long addr)
+{
+    unsigned long long block = addr >> sh->b, d, td;
+    unsigned int hash = shards_hash(block);
+    int g = hash % SHARDS_GROUPS;
+    double rate, grate;
+    int reused;
+    sh->accesses++;
+    if (hash >= sh->threshold) {
+        return 0;
+    }
+    rate = (double) sh->threshold / SHARDS_P;
+    grate = rate / SHARDS_GROUPS;
+    sh->sampled++;
+    reused = reuse_touch(&sh->rp, block, &d, &td);
+    if (reused < 0) {
+        return -1;
+    }
+    // a sampled access stands for 1/rate accesses, a distance for d/rate.
+    if (reused) {
+        sh->rdw[reuse_bin((unsigned long long) (d / rate))] += 1 / rate;
+    } else {
+        sh->coldw += 1 / rate;
+        heap_push(sh, hash, block);
+    }
+    // and within its group, one of SHARDS_GROUPS samples at rate / SHARDS_GROUPS.
+    reused = reuse_touch(&sh->grp[g], block, &d, &td);
+    if (reused < 0) {
+        return -1;
+    }
+    if (reused) {
+        sh->rdg[g][reuse_bin((unsigned long long) (d / grate))] += 1 / grate;
+    } else {
+        sh->coldg[g] += 1 / grate;
+    }
+    // over budget, lower the threshold below the largest tracked hash.
+    while (sh->heapn > sh->smax) {
+        sh->threshold = sh->heaphash[0];
+        while (sh->heapn > 0 && sh->heaphash[0] >= sh->threshold) {
+            block = heap_pop(sh);
+            reuse_drop(&sh->rp, block);
+            reuse_drop(&sh->grp[shards_hash(block) % SHARDS_GROUPS], block);
+        }
+    }
+    return 0;
+}
+
+/* Estimated miss ratio of 2^j lines from a scaled cold count and histogram */
+static double shards_ratio(const shards_profile *sh, double cold, const double *rd, int j)
+{
+    double misses = cold;
+    int k;
+    for (k = j + 1; k < REUSE_BINS; k++) {
+        misses += rd[k];
+    }
+    return misses / sh->accesses;
+}
+
+/* Print sampling rate and the estimated LRU miss ratio of every power of 2 size */
+void shards_print(shards_profile *sh)
+{
+    double rate = (double) sh->threshold / SHARDS_P;
+    double ratio, mean, var, r[SHARDS_GROUPS];
+    int g, j, k, maxbin = 0;
+    for (k = 0; k < REUSE_BINS; k++) {
+        if (sh->rdw[k] > 0) maxbin = k;
+    }
+    printf("shards rate:%.6f final_rate:%.6f sampled:%lu/%lu tracked:%d/%d\n",
+           sh->rate0, rate,
+           sh->sampled, sh->accesses, sh->heapn, sh->smax);
+    if (!sh->sampled) {
+        return;
+    }
+    // a size of 2^j lines holds 2^j * rate sampled lines.
+    for (j = 0; (1UL << j) * rate < SHARDS_MIN_LINES; j++);
+    for (; j <= maxbin; j++) {
+        ratio = shards_ratio(sh, sh->coldw, sh->rdw, j);
+        mean = 0;
+        for (g = 0; g < SHARDS_GROUPS; g++) {
+            r[g] = shards_ratio(sh, sh->coldg[g], sh->rdg[g], j);
+            mean += r[g] / SHARDS_GROUPS;
+        }
+        // variance of the mean of the groups, finite population corrected.
+        var = 0;
+        for (g = 0; g < SHARDS_GROUPS; g++) {
+            var += (r[g] - mean) * (r[g] - mean);
+        }
+        var *= (1 - rate) / ((double) SHARDS_GROUPS * (SHARDS_GROUPS - 1));
+        printf("mrc lines=%lu miss_ratio:%.4f +-%.4f\n",
+               1UL << j, ratio > 1 ? 1 : ratio, SHARDS_T * sqrt(var));
+    }
+}
+
+/* Free sampler memory */
+void shards_free(shards_profile *sh)
+{
+    int g;
+    free(sh->heaphash);
+    free(sh->heapblock);
+    reuse_profile_free(&sh->rp);
+    for (g = 0; g < SHARDS_GROUPS; g++) {
+        reuse_profile_free(&sh->grp[g]);
+    }
+    memset(sh, 0, sizeof(*sh));
+}
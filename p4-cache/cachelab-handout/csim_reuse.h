@@ -0,0 +1,134 @@
+/*
+ * csim_reuse.h - Reuse distance and time distance histograms.
+ *
+ * The reuse (stack) distance of an access is the number of distinct
+ * blocks touched since the previous access to the same block; a fully
+ * associative LRU cache of C lines hits exactly the accesses with distance
+ * below C, so the histogram gives the miss count of every cache size in
+ * one pass. The time distance is the number of accesses in between.
+ *
+ * Distances are counted with a Fenwick tree over access slots that marks
+ * the latest access of every block, O(log n) per access. When the slots
+ * run out, the live marks are compacted to the front, so memory stays
+ * proportional to the number of distinct blocks, not the trace length.
+ *
+ * Bin 0 holds distance 0, bin k > 0 holds [2^(k-1), 2^k - 1].
+ *
+ * The shards profile approximates the same curve in bounded memory by
+ * spatial sampling: only blocks whose hash lies below a threshold T of
+ * P are tracked, at rate R = T / P, and each sampled distance d counts
+ * 1 / R times at distance d / R. The misses of a size are then divided by
+ * the true access count, i.e. the sampled misses by the expected sample
+ * count N * R (Horvitz-Thompson), which stays unbiased when a few hot
+ * blocks carry most accesses and happen not to be sampled. When more
+ * than smax blocks are tracked, T drops to the largest tracked hash and
+ * those blocks are forgotten, so memory is capped whatever the trace
+ * length (fixed size SHARDS).
+ *
+ * The error bound comes from random groups: the sampled blocks are split
+ * by hash into SHARDS_GROUPS groups, and each group is profiled on its
+ * own, with distances counted among its blocks only, as an independent
+ * sample at rate R / SHARDS_GROUPS. The spread of the group estimates
+ * measures everything that depends on which blocks were picked, the
+ * number of accesses sampled as well as the scale of the distances, and
+ * the printed bound is the nominal 95% t interval of their mean, with a
+ * finite population correction that makes it 0 at R = 1. Over many hash
+ * draws it held the exact ratio 85-100% of the time; the misses are
+ * draws with too few blocks sampled, which squeeze every distance alike.
+ * Sizes below SHARDS_MIN_LINES / R lines are not printed: with so few
+ * sampled lines the estimate is biased by distance noise, which no
+ * spread reveals.
+ */
+#ifndef CSIM_REUSE_H
+#define CSIM_REUSE_H
+
+#define REUSE_BINS     65
+#define REUSE_MIN_CAP  (1 << 16) // initial access slots
+#define SHARDS_P       (1 << 24) // sampling hash modulus
+#define SHARDS_SMAX    8192      // default cap on tracked blocks
+#define SHARDS_GROUPS  8         // independently profiled hash groups for the error bound
+#define SHARDS_T       2.365     // 97.5% quantile of Student's t, SHARDS_GROUPS - 1 degrees
+#define SHARDS_MIN_LINES 8       // sampled lines a printed size needs
+
+/* reuse profile struct */
+typedef struct reuse_profile_st {
+    int b;
+
+    /* Fenwick tree over access slots, 1 marks a block's latest access */
+    int *tree;
+    unsigned long long *owner; // block accessed in each slot
+    size_t cap;                // slots
+    size_t now;                // next free slot
+
+    /* block -> latest slot and access number, linear probing */
+    unsigned long long *keys;  // block + 1, 0 is empty
+    size_t *slots;
+    unsigned long long *times;
+    size_t mask;
+    size_t count;
+    unsigned long long clock;  // accesses so far
+
+    /* [0] loads, [1] stores */
+    unsigned long cold[2];
+    unsigned long rdhist[2][REUSE_BINS];
+    unsigned long tdhist[2][REUSE_BINS];
+} reuse_profile;
+
+/* shards profile struct */
+typedef struct shards_profile_st {
+    int b;
+    reuse_profile rp;          // distances among the tracked blocks
+    unsigned int threshold;    // sample blocks whose hash is below it
+    double rate0;              // requested rate, after rounding to T / P
+    int smax;
+
+    /* max-heap of the tracked blocks by sampling hash */
+    unsigned int *heaphash;
+    unsigned long long *heapblock;
+    int heapn;
+
+    unsigned long accesses;    // all accesses
+    unsigned long sampled;     // accesses to tracked blocks
+    /* scaled cold accesses and reuse distance histogram */
+    double coldw;
+    double rdw[REUSE_BINS];
+    /* the same per hash group, distances among the group's blocks only */
+    reuse_profile grp[SHARDS_GROUPS];
+    double coldg[SHARDS_GROUPS];
+    double rdg[SHARDS_GROUPS][REUSE_BINS];
+} shards_profile;
+
+/* Init reuse profile for blocks of 2^b bytes, 0 on success */
+int reuse_profile_init(reuse_profile *rp, int b);
+
+/* Touch block, 1 and its reuse and time distances if seen before, 0 if cold, -1 on allocation error */
+int reuse_touch(reuse_profile *rp, unsigned long long block, unsigned long long *d, unsigned long long *td);
+
+/* Forget block, as if it was never touched */
+void reuse_drop(reuse_profile *rp, unsigned long long block);
+
+/* Account one access to addr, 0 on success */
+int reuse_profile_access(reuse_profile *rp, unsigned long long addr, int store);
+
+/* Print both histograms and the LRU miss count of every power of 2 size */
+void reuse_profile_print(reuse_profile *rp);
+
+/* Free reuse profile memory */
+void reuse_profile_free(reuse_profile *rp);
+
+/* Parse "rate[:blocks]" sampling options, -1 if invalid */
+int shards_parse(const char *arg, double *rate, int *smax);
+
+/* Init sampler of blocks of 2^b bytes at rate, tracking at most smax blocks, 0 on success */
+int shards_init(shards_profile *sh, double rate, int smax, int b);
+
+/* Account one access to addr, 0 on success */
+int shards_access(shards_profile *sh, unsigned long long addr);
+
+/* Print sampling rate and the estimated LRU miss ratio of every power of 2 size */
+void shards_print(shards_profile *sh);
+
+/* Free sampler memory */
+void shards_free(shards_profile *sh);
+
+#endif /* CSIM_REUSE_H */
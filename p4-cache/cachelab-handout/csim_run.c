@@ -0,0 +1,162 @@
+/*
+ * csim_run.c - The csim command line side of the engine: trace record
+ * dispatch, verbose output and the per-access hooks of the L1 analyses.
+ * Unlike libcsim these may print, and exit when an analysis runs out of
+ * memory.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "csim_cli.h"
+
+/* Feed the L1 access co with result optres to the analyses of csim run cli */
+void observe_l1(void *arg, cache_opt co, cache_opt_res optres)
+{
+    csim_cli *cli = (csim_cli *) arg;
+    if (cli->mc) {
+        miss_3c_access(cli->mc, co.addr >> cli->sc.b, (optres & CSIM_MISS) != 0);
+    }
+    if (cli->rd && reuse_profile_access(cli->rd, co.addr, 'S' == co.opttype) < 0) {
+        fprintf(stderr, "Reuse Memory allocation error!");
+        exit(1);
+    }
+    if (cli->sh && shards_access(cli->sh, co.addr) < 0) {
+        fprintf(stderr, "Sampling Memory allocation error!");
+        exit(1);
+    }
+    if (cli->pcs && pc_profile_access(cli->pcs, cli->sc.pc, (optres & CSIM_MISS) != 0) < 0) {
+        fprintf(stderr, "PC Memory allocation error!");
+        exit(1);
+    }
+    if (cli->rg) {
+        region_map_access(cli->rg, co.addr, (optres & CSIM_HIT) != 0, (optres & CSIM_EVICTION) != 0, cli->sc.victim);
+    }
+}
+
+/* Do normal cache opeartion */
+void do_cache_opt(csim_cli *cli, cache_opt co)
+{
+    // instruction or data opt.
+    switch (co.inst) {
+    case 'I': // do instruction related opt.
+        cli->sc.pc = co.addr; // PC of the data records that follow.
+        return;
+    case ' ': // do data releated opt.
+        break;
+    default:
+        printf("Unreconginzed operation type %c!\n", co.inst);  // process continue.
+        return;
+    }
+    // do task according to data operation type.
+    switch (co.opttype) {
+    case 'L': // do load data opt.
+        // printf("Do load data task.\n");
+        do_load_data(cli, co);
+        break;
+    case 'S': // do store data opt.
+        // printf("Do store data task.\n");
+        do_store_data(cli, co);
+        break;
+    case 'M': // do modify data opt.
+        // printf("Do modify data task.\n");
+        do_modify_data(cli, co);
+        break;
+    default:
+        printf("Unreconginzed data operation type %c!\n", co.opttype); // process continue.
+        return;
+    }
+}
+
+/* Do stack distance profile opeartion */
+void do_stack_opt(csim_cli *cli, cache_opt co)
+{
+    if (' ' != co.inst) { // instruction fetches are not simulated.
+        return;
+    }
+    switch (co.opttype) {
+    case 'M': // load then store, the store always hits.
+        stack_profile_access(&cli->sp, co.addr);
+        /* fall through */
+    case 'L':
+    case 'S':
+        stack_profile_access(&cli->sp, co.addr);
+        break;
+    default:
+        printf("Unreconginzed data operation type %c!\n", co.opttype); // process continue.
+        return;
+    }
+}
+
+/* Do n cache operations in trace order, host prefetching the sets of those ahead */
+void do_cache_batch(csim_cli *cli, const cache_opt *ops, int n)
+{
+    int i;
+    if (!cli->sc.hostpf) { // the sets are already in the host caches.
+        for (i = 0; i < n; i++) {
+            do_cache_opt(cli, ops[i]);
+        }
+        return;
+    }
+    for (i = 0; i < n && i < CSIM_PF_AHEAD; i++) {
+        host_prefetch_set(&cli->sc, ops[i].addr);
+    }
+    for (i = 0; i < n; i++) {
+        if (i + CSIM_PF_AHEAD < n) {
+            host_prefetch_set(&cli->sc, ops[i + CSIM_PF_AHEAD].addr);
+        }
+        do_cache_opt(cli, ops[i]);
+    }
+}
+
+/* Do load data task */
+void do_load_data(csim_cli *cli, cache_opt co)
+{
+    cache_opt_res optres = 0;
+    do_base_opt(&cli->sc, &cli->sc.cs, co, &optres);
+    // print verbose if enable.
+    print_verbose(cli, co, optres, 1);
+    if (cli->verbose) printf("\n");
+}
+
+/* Do store data task */
+void do_store_data(csim_cli *cli, cache_opt co)
+{
+    cache_opt_res optres = 0;
+    do_base_opt(&cli->sc, &cli->sc.cs, co, &optres);
+    // print verbose if enable.
+    print_verbose(cli, co, optres, 1);
+    if (cli->verbose) printf("\n");
+}
+
+/* Do modify data task */
+void do_modify_data(csim_cli *cli, cache_opt co)
+{
+    cache_opt_res optres = 0;
+    do_base_opt(&cli->sc, &cli->sc.cs, co, &optres);
+    // print verbose if enable.
+    print_verbose(cli, co, optres, 1);
+    optres = 0;
+    co.opttype = 'S'; // then store it back.
+    do_base_opt(&cli->sc, &cli->sc.cs, co, &optres);
+    print_verbose(cli, co, optres, 0);
+    if (cli->verbose) printf("\n");
+
+}
+
+/* Print cache opt result info */
+void print_verbose(csim_cli *cli, cache_opt co, cache_opt_res optres, int flag)
+{
+    if (cli->verbose) {
+        if (flag) {
+            printf("%c %llx,%d", co.opttype, co.addr, co.size);
+        }
+        if (optres & CSIM_HIT) {
+            printf(" hit");
+        }
+        if (optres & CSIM_MISS) {
+            printf(" miss");
+        }
+        if (optres & CSIM_EVICTION) {
+            printf(" eviction");
+        }
+    }
+}
@@ -0,0 +1,183 @@
+/*
+ * csim_shard.c - Set-sharded multi-threaded simulation engine.
+ *
+ * Cache sets never interact, so the calling thread decodes the trace and
+ * routes each access by set index to the worker that owns that set range.
+ * Every worker keeps the accesses of its sets in trace order and counts
+ * into its own copy of the cache struct, whose statistics are merged at
+ * the end; the totals are therefore exactly those of the serial engine.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "csim_cli.h"
+
+#define SHARD_BATCH  4096 // records per hand-off
+#define SHARD_DEPTH  4    // batches in flight per worker
+
+/* record batch struct */
+typedef struct shard_batch_st {
+    int n;
+    cache_opt ops[SHARD_BATCH];
+} shard_batch;
+
+/* shard worker struct */
+typedef struct shard_worker_st {
+    pthread_t tid;
+    /*
+     * Private copy of the cache: it shares the arena, whose sets this
+     * worker alone touches, and owns the statistics, fill count and last
+     * victim the engine writes on every access.
+     */
+    simulator_cache sc;
+
+    /* bounded ring of batches, filled by the decoder */
+    shard_batch *ring;
+    unsigned long filled;   // batches published by the decoder
+    unsigned long consumed; // batches finished by the worker
+    int closed;             // no more batches will come
+    pthread_mutex_t lock;
+    pthread_cond_t notempty;
+    pthread_cond_t notfull;
+} shard_worker;
+
+/* Worker thread body, simulate batches until the ring is closed */
+static void *shard_worker_main(void *arg)
+{
+    shard_worker *w = (shard_worker *) arg;
+    cache_opt_res optres;
+    int i;
+    for (;;) {
+        pthread_mutex_lock(&w->lock);
+        while (w->filled == w->consumed && !w->closed) {
+            pthread_cond_wait(&w->notempty, &w->lock);
+        }
+        if (w->filled == w->consumed) { // closed and drained.
+            pthread_mutex_unlock(&w->lock);
+            break;
+        }
+        shard_batch *batch = &w->ring[w->consumed % SHARD_DEPTH];
+        pthread_mutex_unlock(&w->lock);
+
+        for (i = 0; i < batch->n; i++) {
+            if (w->sc.hostpf && i + CSIM_PF_AHEAD < batch->n) {
+                host_prefetch_set(&w->sc, batch->ops[i + CSIM_PF_AHEAD].addr);
+            }
+            optres = 0;
+            do_base_opt(&w->sc, &w->sc.cs, batch->ops[i], &optres);
+            if ('M' == batch->ops[i].opttype) {
+                cache_opt co = batch->ops[i];
+                co.opttype = 'S'; // then store it back.
+                do_base_opt(&w->sc, &w->sc.cs, co, &optres);
+            }
+        }
+
+        pthread_mutex_lock(&w->lock);
+        w->consumed++;
+        pthread_cond_signal(&w->notfull);
+        pthread_mutex_unlock(&w->lock);
+    }
+    return NULL;
+}
+
+/* Publish the batch being filled and return the next free one */
+static shard_batch *shard_publish(shard_worker *w)
+{
+    pthread_mutex_lock(&w->lock);
+    w->filled++;
+    pthread_cond_signal(&w->notempty);
+    while (w->filled - w->consumed >= SHARD_DEPTH) {
+        pthread_cond_wait(&w->notfull, &w->lock);
+    }
+    shard_batch *batch = &w->ring[w->filled % SHARD_DEPTH];
+    pthread_mutex_unlock(&w->lock);
+    batch->n = 0;
+    return batch;
+}
+
+/* Handle cache operations on set-sharded worker threads */
+void handle_cache_sharded(csim_cli *cli, trace_reader *tr)
+{
+    simulator_cache *sc = &cli->sc;
+    int nworkers = cli->nthreads < sc->setcnt ? cli->nthreads : sc->setcnt;
+    shard_worker *workers = (shard_worker *) calloc(nworkers, sizeof(shard_worker));
+    shard_batch **cur = (shard_batch **) calloc(nworkers, sizeof(shard_batch *));
+    cache_opt co;
+    int i;
+    if (!workers || !cur) {
+        fprintf(stderr, "Shard Memory allocation error!");
+        exit(1);
+    }
+    for (i = 0; i < nworkers; i++) {
+        shard_worker *w = &workers[i];
+        w->sc = *sc;
+        memset(&w->sc.cs, 0, sizeof(cache_stats));
+        w->sc.fills = 0;
+        w->ring = (shard_batch *) malloc(SHARD_DEPTH * sizeof(shard_batch));
+        if (!w->ring) {
+            fprintf(stderr, "Shard Memory allocation error!");
+            exit(1);
+        }
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->notempty, NULL);
+        pthread_cond_init(&w->notfull, NULL);
+        cur[i] = &w->ring[0];
+        cur[i]->n = 0;
+        if (pthread_create(&w->tid, NULL, shard_worker_main, w) != 0) {
+            fprintf(stderr, "Unable to create worker thread\n");
+            exit(1);
+        }
+    }
+
+    // decode and route, worker i owns sets [i*setcnt/n, (i+1)*setcnt/n).
+    while (trace_next(tr, &co)) {
+        if ('I' == co.inst) {
+            continue;
+        }
+        if (' ' != co.inst) {
+            printf("Unreconginzed operation type %c!\n", co.inst);  // process continue.
+            continue;
+        }
+        if ('L' != co.opttype && 'S' != co.opttype && 'M' != co.opttype) {
+            printf("Unreconginzed data operation type %c!\n", co.opttype); // process continue.
+            continue;
+        }
+        unsigned long setno = (co.addr & sc->setmask) >> sc->b;
+        int wi = (int) ((setno * nworkers) >> sc->s);
+        shard_batch *batch = cur[wi];
+        batch->ops[batch->n++] = co;
+        if (SHARD_BATCH == batch->n) {
+            cur[wi] = shard_publish(&workers[wi]);
+        }
+    }
+
+    // flush partial batches, close rings and merge statistics.
+    for (i = 0; i < nworkers; i++) {
+        shard_worker *w = &workers[i];
+        pthread_mutex_lock(&w->lock);
+        if (cur[i]->n > 0) {
+            w->filled++;
+        }
+        w->closed = 1;
+        pthread_cond_signal(&w->notempty);
+        pthread_mutex_unlock(&w->lock);
+    }
+    for (i = 0; i < nworkers; i++) {
+        shard_worker *w = &workers[i];
+        pthread_join(w->tid, NULL);
+        sc->cs.hits += w->sc.cs.hits;
+        sc->cs.misses += w->sc.cs.misses;
+        sc->cs.evictions += w->sc.cs.evictions;
+        sc->cs.dirty_evictions += w->sc.cs.dirty_evictions;
+        sc->cs.writebacks += w->sc.cs.writebacks;
+        sc->cs.write_bytes += w->sc.cs.write_bytes;
+        sc->fills += w->sc.fills;
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->notempty);
+        pthread_cond_destroy(&w->notfull);
+        free(w->ring);
+    }
+    free(cur);
+    free(workers);
+}
@@ -0,0 +1,98 @@
+/*
+ * csim_stack.c - Single pass LRU stack distance profile.
+ *
+ * An access found at (0 based) depth d hits for every E > d and misses,
+ * with an eviction, for every E <= d. A block missing from the stack
+ * misses for all E and evicts for every E not above the pre-access depth,
+ * since an LRU set of E lines is full once it has seen E distinct blocks.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "csim_stack.h"
+
+/* Init stack profile for s/b and associativities 1..maxassoc, 0 on success */
+int stack_profile_init(stack_profile *sp, int s, int maxassoc, int b)
+{
+    memset(sp, 0, sizeof(*sp));
+    sp->s = s;
+    sp->b = b;
+    sp->setcnt = 0x01 << s;
+    sp->maxassoc = maxassoc;
+    sp->tags = (unsigned long long *) malloc((size_t) sp->setcnt * maxassoc * sizeof(unsigned long long));
+    sp->depth = (int *) calloc(sp->setcnt, sizeof(int));
+    sp->hithist = (unsigned long *) calloc(maxassoc + 1, sizeof(unsigned long));
+    sp->evhist = (unsigned long *) calloc(maxassoc + 1, sizeof(unsigned long));
+    if (!sp->tags || !sp->depth || !sp->hithist || !sp->evhist) {
+        stack_profile_free(sp);
+        return -1;
+    }
+    return 0;
+}
+
+/* Account one access to addr */
+void stack_profile_access(stack_profile *sp, unsigned long long addr)
+{
+    int setno = (addr >> sp->b) & (sp->setcnt - 1);
+    unsigned long long tag = addr >> (sp->b + sp->s);
+    unsigned long long *stack = sp->tags + (size_t) setno * sp->maxassoc;
+    int depth = sp->depth[setno];
+    int d;
+    sp->accesses++;
+    for (d = 0; d < depth; d++) {
+        if (stack[d] == tag) {
+            break;
+        }
+    }
+    if (d < depth) { // hit for E > d.
+        sp->hithist[d]++;
+        sp->evhist[d]++;
+    } else { // miss for all E.
+        sp->evhist[depth]++;
+        if (depth < sp->maxassoc) {
+            sp->depth[setno] = ++depth;
+        }
+        d = depth - 1; // the bottom entry falls off.
+    }
+    // move to front.
+    memmove(stack + 1, stack, d * sizeof(unsigned long long));
+    stack[0] = tag;
+}
+
+/* Get hits, misses and evictions for associativity E */
+void stack_profile_result(stack_profile *sp, int E, unsigned long *hits,
+                          unsigned long *misses, unsigned long *evictions)
+{
+    unsigned long h = 0, ev = 0;
+    int i;
+    for (i = 0; i < E && i < sp->maxassoc; i++) {
+        h += sp->hithist[i];
+    }
+    for (i = E; i <= sp->maxassoc; i++) {
+        ev += sp->evhist[i];
+    }
+    *hits = h;
+    *misses = sp->accesses - h;
+    *evictions = ev;
+}
+
+/* Print one result row per associativity */
+void stack_profile_print(stack_profile *sp)
+{
+    unsigned long hits, misses, evictions;
+    int E;
+    for (E = 1; E <= sp->maxassoc; E++) {
+        stack_profile_result(sp, E, &hits, &misses, &evictions);
+        printf("E=%d hits:%lu misses:%lu evictions:%lu\n", E, hits, misses, evictions);
+    }
+}
+
+/* Free stack profile memory */
+void stack_profile_free(stack_profile *sp)
+{
+    free(sp->tags);
+    free(sp->depth);
+    free(sp->hithist);
+    free(sp->evhist);
+    memset(sp, 0, sizeof(*sp));
+}
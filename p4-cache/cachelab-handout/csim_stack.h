@@ -0,0 +1,40 @@
+/*
+ * csim_stack.h - Single pass LRU stack distance profile (Mattson et al.).
+ *
+ * For a fixed set count, an LRU cache of associativity k hits exactly when
+ * the block's distance from the top of its set's recency stack is below k.
+ * Keeping one recency stack of depth N per set therefore yields hits,
+ * misses and evictions for every associativity 1..N in a single pass.
+ */
+#ifndef CSIM_STACK_H
+#define CSIM_STACK_H
+
+/* stack distance profile struct */
+typedef struct stack_profile_st {
+    int s, b;
+    int setcnt;
+    int maxassoc;          // N, deepest associativity tracked
+    unsigned long long *tags; // setcnt stacks of maxassoc tags, MRU first
+    int *depth;            // valid entries per stack, min(distinct, N)
+    unsigned long *hithist; // hithist[d]: hits at stack distance d
+    unsigned long *evhist;  // evhist[x]: misses evicting for E <= x
+    unsigned long accesses;
+} stack_profile;
+
+/* Init stack profile for s/b and associativities 1..maxassoc, 0 on success */
+int stack_profile_init(stack_profile *sp, int s, int maxassoc, int b);
+
+/* Account one access to addr */
+void stack_profile_access(stack_profile *sp, unsigned long long addr);
+
+/* Get hits, misses and evictions for associativity E */
+void stack_profile_result(stack_profile *sp, int E, unsigned long *hits,
+                          unsigned long *misses, unsigned long *evictions);
+
+/* Print one result row per associativity */
+void stack_profile_print(stack_profile *sp);
+
+/* Free stack profile memory */
+void stack_profile_free(stack_profile *sp);
+
+#endif /* CSIM_STACK_H */
@@ -0,0 +1,466 @@
+/*
+ * csim_trace.c - Trace readers for the cache simulator.
+ *
+ * The mmap reader never copies a line: it walks the mapped bytes with a
+ * small hand-written hex/decimal scanner, so line length is unbounded and
+ * there is no per-line memset/sscanf/trim work. The binary reader shares
+ * the mapping code and decodes traceconv output (see csim_trace.h).
+ *
+ * Unmappable inputs run the same parsers over a sliding read(2) buffer;
+ * a text line longer than the buffer keeps its leading record fields and
+ * the rest is dropped.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "csim_trace.h"
+
+// "<inst><op> " + 16 hex digits + "," + size + "\r\n", with room for padding.
+#define LINE_LENGTH  64
+
+/* Trim white space for string */
+static char *trim_white_space(char *str);
+
+/* Parse one record in place, advance *pp past its line */
+static int parse_record(const char **pp, const char *end, cache_opt *co,
+                        unsigned long long *fulladdr);
+
+/* Decode one binary record, advance the reader past it */
+static int decode_record(trace_reader *tr, cache_opt *co);
+
+/* Map the whole file read only, return 0 on success and 1 if unmappable */
+static int map_file(trace_reader *tr);
+
+/* Read more bytes into the stream buffer, return 0 once nothing was added */
+static int stream_fill(trace_reader *tr);
+
+/* Fetch next text record from the stream buffer */
+static int stream_next(trace_reader *tr, cache_opt *co);
+
+/* Check binary trace header, return 0 if valid */
+static int check_bin_header(trace_reader *tr);
+
+// returns a pointer to a substring of the original string.
+// the return string can not be free.
+static char *trim_white_space(char *str)
+{
+  char *end;
+
+  // Trim leading space
+  while(isspace((unsigned char)*str)) str++;
+
+  if(*str == 0)  // All spaces?
+    return str;
+
+  // Trim trailing space
+  end = str + strlen(str) - 1;
+  while(end > str && isspace((unsigned char)*end)) end--;
+
+  // Write new null terminator character
+  end[1] = '\0';
+
+  return str;
+}
+
+/* Parse trace reader kind name, return -1 if unknown */
+int trace_parse_kind(const char *name)
+{
+    if (0 == strcmp(name, "mmap")) return TRACE_MMAP;
+    if (0 == strcmp(name, "stdio")) return TRACE_STDIO;
+    if (0 == strcmp(name, "bin")) return TRACE_BIN;
+    return -1;
+}
+
+/* Map the whole file read only, return 0 on success and 1 if unmappable */
+static int map_file(trace_reader *tr)
+{
+    struct stat st;
+    tr->fd = 0 == strcmp(tr->path, "-") ? STDIN_FILENO : open(tr->path, O_RDONLY);
+    if (tr->fd < 0) {
+        return -1;
+    }
+    if (fstat(tr->fd, &st) < 0) {
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) { // pipe, tty..., keep fd for streaming.
+        return 1;
+    }
+    tr->maplen = st.st_size;
+    if (tr->maplen > 0) { // mmap refuses zero length mapping.
+        tr->base = mmap(NULL, tr->maplen, PROT_READ, MAP_PRIVATE, tr->fd, 0);
+        if (MAP_FAILED == tr->base) {
+            tr->base = NULL;
+            return -1;
+        }
+        posix_madvise(tr->base, tr->maplen, POSIX_MADV_SEQUENTIAL);
+    }
+    tr->cur = tr->base;
+    tr->end = tr->base + tr->maplen;
+    return 0;
+}
+
+/* Check binary trace header, return 0 if valid */
+static int check_bin_header(trace_reader *tr)
+{
+    const unsigned char *h = (const unsigned char *) tr->cur;
+    int i;
+    if (tr->end - tr->cur < TRACE_BIN_HDR_LEN
+        || 0 != memcmp(h, TRACE_BIN_MAGIC, 4)
+        || TRACE_BIN_VERSION != h[4]
+        || (32 != h[5] && 64 != h[5])) {
+        return -1;
+    }
+    tr->addrbits = h[5];
+    tr->nrecords = 0;
+    for (i = 7; i >= 0; i--) {
+        tr->nrecords = (tr->nrecords << 8) | h[8 + i];
+    }
+    tr->cur += TRACE_BIN_HDR_LEN;
+    return 0;
+}
+
+/* Open trace file by the given reader kind, return 0 on success, else a TRACE_E* code */
+int trace_open(trace_reader *tr, const char *path, trace_kind kind)
+{
+    int rc;
+    memset(tr, 0, sizeof(*tr));
+    tr->fd = -1;
+    tr->path = path;
+    tr->kind = kind;
+    if (TRACE_MMAP == kind || TRACE_BIN == kind) {
+        rc = map_file(tr);
+        if (1 == rc) { // not mappable, stream it.
+            tr->buf = (char *) malloc(TRACE_STREAM_BUF);
+            if (!tr->buf) {
+                trace_close(tr);
+                return TRACE_ENOMEM;
+            }
+            tr->cur = tr->end = tr->buf;
+            rc = 0;
+            if (TRACE_BIN == kind) {
+                while (tr->end - tr->cur < TRACE_BIN_HDR_LEN && stream_fill(tr));
+            }
+        }
+        if (0 == rc && TRACE_BIN == kind && check_bin_header(tr) < 0) {
+            rc = TRACE_EFORMAT;
+        }
+        if (rc < 0) {
+            trace_close(tr);
+            return TRACE_EFORMAT == rc ? rc : TRACE_ENOENT;
+        }
+        return 0;
+    }
+    tr->fp = 0 == strcmp(path, "-") ? stdin : fopen(path, "r");
+    return NULL == tr->fp ? TRACE_ENOENT : 0;
+}
+
+/* Message of trace_open() error err */
+const char *trace_strerror(int err)
+{
+    switch (err) {
+    case TRACE_ENOENT:
+        return "No such file or directory";
+    case TRACE_EFORMAT:
+        return "not a binary trace";
+    case TRACE_ENOMEM:
+        return "Trace Memory allocation error!";
+    default:
+        return "Unknown error";
+    }
+}
+
+/* Read more bytes into the stream buffer, return 0 once nothing was added */
+static int stream_fill(trace_reader *tr)
+{
+    size_t left = tr->end - tr->cur;
+    ssize_t n;
+    if (tr->eof) {
+        return 0;
+    }
+    // slide the unconsumed tail to the front.
+    if (tr->cur != tr->buf) {
+        memmove(tr->buf, tr->cur, left);
+        tr->cur = tr->buf;
+        tr->end = tr->buf + left;
+    }
+    if (TRACE_STREAM_BUF == left) {
+        return 0;
+    }
+    do {
+        n = read(tr->fd, tr->buf + left, TRACE_STREAM_BUF - left);
+    } while (n < 0 && EINTR == errno);
+    if (n <= 0) { // read errors end the trace like EOF does.
+        tr->eof = 1;
+        return 0;
+    }
+    tr->end += n;
+    return 1;
+}
+
+/* Fetch next text record from the stream buffer */
+static int stream_next(trace_reader *tr, cache_opt *co)
+{
+    const char *nl;
+    for (;;) {
+        nl = memchr(tr->cur, '\n', tr->end - tr->cur);
+        if (tr->skipline) { // drop the tail of an overlong line.
+            tr->cur = nl ? nl + 1 : tr->end;
+            tr->skipline = !nl;
+            if (!nl && !stream_fill(tr) && tr->eof) return 0;
+            continue;
+        }
+        if (!nl && stream_fill(tr)) {
+            continue;
+        }
+        if (nl) { // one whole line, blank ones parse to nothing.
+            const char *p = tr->cur;
+            int rc = parse_record(&p, nl + 1, co, &tr->lastaddr);
+            tr->cur = nl + 1;
+            if (rc) return 1;
+            continue;
+        }
+        if (tr->cur == tr->end) {
+            return 0;
+        }
+        // unterminated last line, or a line longer than the buffer.
+        tr->skipline = !tr->eof;
+        return parse_record(&tr->cur, tr->end, co, &tr->lastaddr);
+    }
+}
+
+/* Fetch next record, return 1 if one was read and 0 at end of trace */
+int trace_next(trace_reader *tr, cache_opt *co)
+{
+    if (TRACE_MMAP == tr->kind) {
+        if (tr->buf) return stream_next(tr, co);
+        return parse_record(&tr->cur, tr->end, co, &tr->lastaddr);
+    }
+    if (TRACE_BIN == tr->kind) {
+        // keep a whole record buffered while streaming.
+        while (tr->buf && tr->end - tr->cur < TRACE_BIN_MAX_REC && stream_fill(tr));
+        return decode_record(tr, co);
+    }
+    char linestr[LINE_LENGTH] = {0};
+    do { // skip whitespace-only lines, as parse_record() does.
+        if (!fgets(linestr, sizeof(linestr) - 1, tr->fp)) {
+            return 0;
+        }
+        if (!strchr(linestr, '\n')) {
+            int c;
+            while ((c = getc(tr->fp)) != EOF && '\n' != c); // drop the rest of an overlong line.
+        }
+        sscanf(linestr,"%c%c %llx,%d", &co->inst, &co->opttype, &co->addr, &co->size);
+    } while (0 == strcmp(trim_white_space(linestr), ""));
+    tr->lastaddr = co->addr;
+    return 1;
+}
+
+/* Release trace reader resources */
+void trace_close(trace_reader *tr)
+{
+    if (tr->base) {
+        munmap(tr->base, tr->maplen);
+    }
+    free(tr->buf);
+    if (tr->fd > STDIN_FILENO) {
+        close(tr->fd);
+    }
+    if (tr->fp && stdin != tr->fp) {
+        fclose(tr->fp);
+    }
+    memset(tr, 0, sizeof(*tr));
+    tr->fd = -1;
+}
+
+/*
+ * Parse one record in place, advance *pp past its line.
+ * Record layout is "<inst><opttype> <hex addr>,<dec size>", e.g. " L 10,4"
+ * or "I  0400d7d4,8". Whitespace-only lines are skipped.
+ */
+static int parse_record(const char **pp, const char *end, cache_opt *co,
+                        unsigned long long *fulladdr)
+{
+    const char *p = *pp;
+    const char *q;
+    // skip blank lines.
+    for (;;) {
+        q = p;
+        while (q < end && (' ' == *q || '\t' == *q || '\r' == *q)) q++;
+        if (q == end) {
+            *pp = end;
+            return 0;
+        }
+        if ('\n' != *q) {
+            break;
+        }
+        p = q + 1;
+    }
+    co->inst = *p++;
+    co->opttype = (p < end && '\n' != *p) ? *p++ : ' ';
+    while (p < end && ' ' == *p) p++;
+    // hex address.
+    unsigned long long addr = 0;
+    for (; p < end; p++) {
+        unsigned c = (unsigned char) *p;
+        if (c - '0' < 10) {
+            addr = (addr << 4) | (c - '0');
+        } else if ((c | 0x20) - 'a' < 6) {
+            addr = (addr << 4) | ((c | 0x20) - 'a' + 10);
+        } else {
+            break;
+        }
+    }
+    co->addr = addr;
+    *fulladdr = addr;
+    // decimal size.
+    int size = 0;
+    if (p < end && ',' == *p) {
+        for (p++; p < end && (unsigned) (*p - '0') < 10; p++) {
+            size = size * 10 + (*p - '0');
+        }
+    }
+    co->size = size;
+    // skip the rest of the line, however long it is.
+    q = memchr(p, '\n', end - p);
+    *pp = q ? q + 1 : end;
+    return 1;
+}
+
+/* Read one LEB128 varint, return 0 if the input is truncated */
+static int get_varint(const char **pp, const char *end, unsigned long long *v)
+{
+    const unsigned char *p = (const unsigned char *) *pp;
+    unsigned long long x = 0;
+    int shift = 0;
+    for (; p < (const unsigned char *) end && shift < 64; shift += 7) {
+        unsigned char c = *p++;
+        x |= (unsigned long long) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *pp = (const char *) p;
+            *v = x;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Decode one binary record, advance the reader past it */
+static int decode_record(trace_reader *tr, cache_opt *co)
+{
+    static const char optchars[4] = {' ', 'L', 'S', 'M'};
+    const char *p = tr->cur;
+    unsigned long long v;
+    if (p >= tr->end) {
+        return 0;
+    }
+    unsigned char hd = (unsigned char) *p++;
+    int op = hd & 0x03;
+    int size = hd >> 2;
+    if (TRACE_BIN_SIZE_ESC == size) {
+        if (!get_varint(&p, tr->end, &v)) return 0;
+        size = (int) v;
+    }
+    if (!get_varint(&p, tr->end, &v)) return 0;
+    // undo zigzag, then apply delta.
+    tr->lastaddr += (v >> 1) ^ (0 - (v & 1));
+    if (32 == tr->addrbits) {
+        tr->lastaddr &= 0xffffffffULL;
+    }
+    tr->cur = p;
+    co->inst = op ? ' ' : 'I';
+    co->opttype = optchars[op];
+    co->addr = tr->lastaddr;
+    co->size = size;
+    return 1;
+}
+
+/* Write one LEB128 varint */
+static void put_varint(FILE *fp, unsigned long long v)
+{
+    while (v >= 0x80) {
+        putc((int) (v & 0x7f) | 0x80, fp);
+        v >>= 7;
+    }
+    putc((int) v, fp);
+}
+
+/* Write binary trace header */
+static int put_bin_header(trace_bin_writer *tw)
+{
+    unsigned char h[TRACE_BIN_HDR_LEN] = {0};
+    int i;
+    memcpy(h, TRACE_BIN_MAGIC, 4);
+    h[4] = TRACE_BIN_VERSION;
+    h[5] = (unsigned char) tw->addrbits;
+    for (i = 0; i < 8; i++) {
+        h[8 + i] = (unsigned char) (tw->nrecords >> (8 * i));
+    }
+    return fwrite(h, 1, sizeof(h), tw->fp) == sizeof(h) ? 0 : -1;
+}
+
+/* Create binary trace file, return 0 on success */
+int trace_bin_create(trace_bin_writer *tw, const char *path)
+{
+    memset(tw, 0, sizeof(*tw));
+    tw->addrbits = 32;
+    tw->fp = fopen(path, "wb");
+    if (NULL == tw->fp) {
+        return -1;
+    }
+    // placeholder, patched by trace_bin_finish().
+    return put_bin_header(tw);
+}
+
+/* Append one record, opttype is 'I', 'L', 'S' or 'M' */
+int trace_bin_put(trace_bin_writer *tw, char opttype, unsigned long long addr, int size)
+{
+    int op;
+    switch (opttype) {
+    case 'I': op = 0; break;
+    case 'L': op = 1; break;
+    case 'S': op = 2; break;
+    case 'M': op = 3; break;
+    default:
+        return -1;
+    }
+    if (size < 0) {
+        return -1;
+    }
+    if (addr > 0xffffffffULL) {
+        tw->addrbits = 64;
+    }
+    unsigned long long delta = addr - tw->lastaddr;
+    tw->lastaddr = addr;
+    if (size < TRACE_BIN_SIZE_ESC) {
+        putc(op | (size << 2), tw->fp);
+    } else {
+        putc(op | (TRACE_BIN_SIZE_ESC << 2), tw->fp);
+        put_varint(tw->fp, (unsigned long long) size);
+    }
+    // zigzag keeps small negative deltas short.
+    put_varint(tw->fp, (delta << 1) ^ (0 - (delta >> 63)));
+    tw->nrecords++;
+    return ferror(tw->fp) ? -1 : 0;
+}
+
+/* Patch the header and close the file, return 0 on success */
+int trace_bin_finish(trace_bin_writer *tw)
+{
+    int rc = 0;
+    if (fseek(tw->fp, 0, SEEK_SET) < 0 || put_bin_header(tw) < 0) {
+        rc = -1;
+    }
+    if (fclose(tw->fp) != 0) {
+        rc = -1;
+    }
+    tw->fp = NULL;
+    return rc;
+}
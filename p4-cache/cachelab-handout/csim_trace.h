@@ -0,0 +1,121 @@
+/*
+ * csim_trace.h - Trace readers for the cache simulator.
+ *
+ * A trace_reader hands out one cache_opt record per call, whatever the
+ * underlying source is. The default reader maps the whole trace file into
+ * memory and parses records in place; the stdio reader is the original
+ * fgets/sscanf path, kept for comparison.
+ *
+ * Path "-" is standard input. Inputs that cannot be mapped (pipes, FIFOs,
+ * ttys) are streamed instead: records are parsed in place from a bounded
+ * buffer of TRACE_STREAM_BUF bytes that is refilled as they are consumed,
+ * so a simulation can run while valgrind is still writing the trace.
+ *
+ * The binary reader decodes the compact format written by traceconv:
+ *
+ *   header (16 bytes, little endian)
+ *     0  magic     "CSBT"
+ *     4  version   1
+ *     5  addrbits  32 or 64, width of the widest address in the trace
+ *     6  reserved  0, 0
+ *     8  nrecords  u64 record count
+ *   records, one per access
+ *     byte 0       bits 0-1 op (0 I, 1 L, 2 S, 3 M), bits 2-7 size;
+ *                  size 63 means a varint with the real size follows
+ *     varint       zigzag delta of the address from the previous record
+ *
+ * Varints are LEB128: 7 bits per byte, low group first, high bit set on
+ * all but the last byte.
+ */
+#ifndef CSIM_TRACE_H
+#define CSIM_TRACE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define TRACE_BIN_MAGIC     "CSBT"
+#define TRACE_BIN_VERSION   1
+#define TRACE_BIN_HDR_LEN   16
+#define TRACE_BIN_SIZE_ESC  63
+#define TRACE_BIN_MAX_REC   21 // header byte and two 10 byte varints
+#define TRACE_STREAM_BUF    (1 << 16)
+
+/* cache operation agrs struct, 16 bytes so it still passes in registers */
+typedef struct {
+    char inst; // if 'I', then it's instruction operation, else data operation.
+    char opttype;
+    int size;
+    unsigned long long addr; // full 64 bit address
+} cache_opt ;
+
+/* trace reader kinds */
+typedef enum {
+    TRACE_MMAP = 0, // mmap the file and parse in place (default)
+    TRACE_STDIO,    // fgets + sscanf, one line at a time
+    TRACE_BIN       // mmap a traceconv binary trace and decode in place
+} trace_kind;
+
+/* trace reader struct */
+typedef struct trace_reader_st {
+    trace_kind kind;
+    const char *path;
+
+    /* mmap reader state */
+    int fd;
+    char *base;      // start of the mapping
+    size_t maplen;   // mapping length
+    const char *cur; // next unparsed byte
+    const char *end; // one past the last byte
+    unsigned long long lastaddr; // full width address of the last record
+
+    /* streaming state, cur/end then point into buf */
+    char *buf;       // NULL unless streaming
+    int eof;         // no more bytes will come
+    int skipline;    // rest of an overlong line still to drop
+
+    /* binary reader state */
+    int addrbits;
+    unsigned long long nrecords;
+
+    /* stdio reader state */
+    FILE *fp;
+} trace_reader;
+
+/* trace_open() errors */
+#define TRACE_ENOENT   -1   // cannot open or map the file
+#define TRACE_EFORMAT  -2   // no binary trace header
+#define TRACE_ENOMEM   -3   // no memory for the stream buffer
+
+/* Open trace file by the given reader kind, return 0 on success, else a TRACE_E* code */
+int trace_open(trace_reader *tr, const char *path, trace_kind kind);
+
+/* Message of trace_open() error err */
+const char *trace_strerror(int err);
+
+/* Fetch next record, return 1 if one was read and 0 at end of trace */
+int trace_next(trace_reader *tr, cache_opt *co);
+
+/* Release trace reader resources */
+void trace_close(trace_reader *tr);
+
+/* Parse trace reader kind name, return -1 if unknown */
+int trace_parse_kind(const char *name);
+
+/* binary trace writer struct */
+typedef struct trace_bin_writer_st {
+    FILE *fp;
+    unsigned long long lastaddr;
+    unsigned long long nrecords;
+    int addrbits;
+} trace_bin_writer;
+
+/* Create binary trace file, return 0 on success */
+int trace_bin_create(trace_bin_writer *tw, const char *path);
+
+/* Append one record, opttype is 'I', 'L', 'S' or 'M' */
+int trace_bin_put(trace_bin_writer *tw, char opttype, unsigned long long addr, int size);
+
+/* Patch the header and close the file, return 0 on success */
+int trace_bin_finish(trace_bin_writer *tw);
+
+#endif /* CSIM_TRACE_H */
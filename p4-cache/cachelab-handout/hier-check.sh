@@ -0,0 +1,56 @@
+#!/bin/bash
+#
+# hier-check.sh - Check csim -H exclusive levels against each other.
+#
+# A stack of n exclusive one-way levels below an L1 holds the last n L1
+# victims of every set, just as one exclusive n-way LRU level does, so
+# both must read and write the same bytes of memory, dirty data handed
+# up through the stack included. Every shipped trace and a small store
+# trace are run both ways for a few geometries; the exit status is 1 if
+# any memory line differs.
+#
+#   linux> make hier-check
+#   linux> ./hier-check.sh traces/long.trace
+#
+usage() {
+    echo "Usage: $0 [-h] [trace...]"
+    echo "  trace...    Valgrind traces to check (default traces/*.trace and a store trace)."
+}
+
+cd "$(dirname "$0")" || exit 1
+while getopts "h" opt; do
+    case $opt in
+    h) usage; exit 0 ;;
+    *) usage; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ -x ./csim ] || make -s csim || exit 1
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+if [ $# -eq 0 ]; then
+    # dirty blocks pushed down two levels, then loaded back through both.
+    printf " S 0,4\n S 10,4\n S 20,4\n L 0,4\n L 30,4\n L 40,4\n L 50,4\n L 60,4\n" > "$tmp/store.trace"
+    set -- traces/*.trace "$tmp/store.trace"
+fi
+bad=0
+# s b, the depth of the stack and the ways of the single level
+for geom in "0 4 2" "0 4 3" "2 4 2" "4 5 3"; do
+    set -- $geom "$@"
+    s=$1 b=$2 n=$3
+    shift 3
+    stack=$(printf "$s:1:$b:excl,%.0s" $(seq $n))
+    for t in "$@"; do
+        a=$(./csim -w wb -s $s -E 1 -b $b -H "${stack%,}" -t "$t" | grep ^memory) || exit 1
+        c=$(./csim -w wb -s $s -E 1 -b $b -H "$s:$n:$b:excl" -t "$t" | grep ^memory) || exit 1
+        if [ "$a" = "$c" ]; then
+            echo "OK       s=$s b=$b levels=$n $t $a"
+        else
+            echo "MISMATCH s=$s b=$b levels=$n $t stacked: $a single: $c"
+            bad=$((bad + 1))
+        fi
+    done
+done
+echo "$bad mismatches"
+[ $bad -eq 0 ]
@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+# shards-check.sh - Check the sampled miss ratio curve of csim -S against
+# the exact one of csim -d.
+#
+# For every shipped trace and sampling rate, every size -S prints is
+# compared with the LRU misses -d counts for that size, divided by the
+# accesses. A row is OK when the exact ratio lies within the printed
+# bound. The bound is a nominal 95% interval, so an odd row outside it
+# is expected, but all rows of the shipped traces are inside; the exit
+# status is 1 if any row is outside.
+#
+#   linux> make shards-check
+#   linux> ./shards-check.sh -r "0.2 0.05" -b 6 traces/long.trace
+#
+usage() {
+    echo "Usage: $0 [-h] [-r <rates>] [-b <num>] [trace...]"
+    echo "  -r <rates>  Sampling rates to check (default \"1 0.5 0.1 0.01\")."
+    echo "  -b <num>    Number of block offset bits (default 5)."
+    echo "  trace...    Valgrind traces to check (default traces/*.trace)."
+}
+
+cd "$(dirname "$0")" || exit 1
+rates="1 0.5 0.1 0.01"
+b=5
+while getopts "hr:b:" opt; do
+    case $opt in
+    h) usage; exit 0 ;;
+    r) rates=$OPTARG ;;
+    b) b=$OPTARG ;;
+    *) usage; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -gt 0 ] || set -- traces/*.trace
+[ -x ./csim ] || make -s csim || exit 1
+
+# one fully associative cache large enough for every printed size.
+geom="-s 0 -E 65536 -b $b"
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+bad=0
+printf "%-20s %6s %7s %9s %9s %9s\n" trace rate lines sampled exact status
+for t in "$@"; do
+    ./csim -d $geom -t "$t" > "$tmp/exact" || exit 1
+    for r in $rates; do
+        ./csim -S "$r" $geom -t "$t" > "$tmp/est" || exit 1
+        out=$(awk -v t="$t" -v r="$r" '
+            FNR == NR && /^lru lines=/ {
+                split($2, a, "="); split($3, m, ":"); exact[a[2]] = m[2]; next
+            }
+            /^shards / { split($4, s, "[:/]"); n = s[3]; next }
+            /^mrc lines=/ {
+                split($2, a, "="); split($3, e, ":"); c = a[2]; w = substr($4, 3) + 0
+                if (!(c in exact)) next
+                # the printed 4 decimals round both by up to 5e-5.
+                x = exact[c] / n; ok = x >= e[2] - w - 1e-4 && x <= e[2] + w + 1e-4
+                printf "%-20s %6s %7s %9s %9.4f %s\n", t, r, c, e[2] $4, x, ok ? "OK" : "OUTSIDE"
+            }' "$tmp/exact" "$tmp/est") || exit 1
+        [ -n "$out" ] && echo "$out"
+        bad=$((bad + $(echo "$out" | grep -c OUTSIDE)))
+    done
+done
+echo "$bad outside the bound"
+[ $bad -eq 0 ]
@@ -3,6 +3,8 @@
  *     student's transpose functions and records the results for their
  *     official submitted version as well.
  */
+#define _POSIX_C_SOURCE 200809L // popen
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -46,15 +48,14 @@ static struct results results = {-1, 0, INT_MAX};
  */
 void eval_perf(unsigned int s, unsigned int E, unsigned int b)
 {
-    int i,flag;
+    int i,flag,status,found;
     unsigned int len, hits, misses, evictions;
     unsigned long long int marker_start, marker_end, addr;
     char buf[1000], cmd[255];
-    char filename[128];
 
     registerFunctions(); 
 
-    /* Open the complete trace file */
+    /* The lackey output streams straight into the simulator */
     FILE* full_trace_fp;  
     FILE* part_trace_fp; 
 
@@ -68,40 +69,28 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
         printf("\nFunction %d (%d total)\nStep 1: Validating and generating memory traces\n",i,func_counter);
         /* Use valgrind to generate the trace */
 
-        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d  > trace.tmp", M, N,i);
-        flag=WEXITSTATUS(system(cmd));
-        if (0!=flag) {
-            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
-            continue;
-        }
-
-        /* Get the start and end marker addresses */
-        FILE* marker_fp = fopen(".marker", "r");
-        assert(marker_fp);
-        fscanf(marker_fp, "%llx %llx", &marker_start, &marker_end);
-        fclose(marker_fp);
-
-
-        func_list[i].correct=1;
-
-        /* Save the correctness of the transpose submission */
-        if (results.funcid == i ) {
-            results.correct = 1;
-        }
-
-        full_trace_fp = fopen("trace.tmp", "r");
+        sprintf(cmd, "valgrind --tool=lackey --trace-mem=yes --log-fd=1 -v ./tracegen -M %d -N %d -F %d", M, N,i);
+        full_trace_fp = popen(cmd, "r");
         assert(full_trace_fp);
 
-
-        /* Filtered trace for each transpose function goes in a separate file */
-        sprintf(filename, "trace.f%d", i);
-        part_trace_fp = fopen(filename, "w");
+        /* The reference simulator reads the filtered trace as it comes */
+        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t /dev/stdin > /dev/null", 
+                s, E, b);
+        part_trace_fp = popen(cmd, "w");
         assert(part_trace_fp);
     
-        /* Locate trace corresponding to the trans function */
+        /* Locate trace corresponding to the trans function, tracegen
+           prints the marker addresses before it calls the function */
         flag = 0;
+        found = 0;
+        marker_start = marker_end = 0;
         while (fgets(buf, 1000, full_trace_fp) != NULL) {
 
+            if (!found && sscanf(buf, "marker %llx %llx", &marker_start, &marker_end) == 2) {
+                found = 1;
+                continue;
+            }
+
             /* We are only interested in memory access instructions */
             if (buf[0]==' ' && buf[2]==' ' &&
                 (buf[1]=='S' || buf[1]=='M' || buf[1]=='L' )) {
@@ -124,22 +113,31 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
                     fputs(buf, part_trace_fp);
                 }
 
-                /* if end marker found, close trace file */
-                if (addr == marker_end) {
+                /* if end marker found, the simulator has all it needs;
+                   keep draining so tracegen can exit */
+                if (found && addr == marker_end) {
                     flag = 0;
-                    fclose(part_trace_fp);
-                    break;
                 }
             }
         }
-        fclose(full_trace_fp);
+        status = pclose(full_trace_fp);
+        pclose(part_trace_fp);
+
+        flag = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+        if (0!=flag) {
+            printf("Validation error at function %d! Run ./tracegen -M %d -N %d -F %d for details.\nSkipping performance evaluation for this function.\n",flag-1,M,N,i);      
+            continue;
+        }
+
+        func_list[i].correct=1;
+
+        /* Save the correctness of the transpose submission */
+        if (results.funcid == i ) {
+            results.correct = 1;
+        }
 
-        /* Run the reference simulator */
+        /* The reference simulator ran alongside valgrind */
         printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
     
         /* Collect results from the reference simulator */
         FILE* in_fp = fopen(".csim_results","r");
@@ -0,0 +1,91 @@
+/*
+ * traceconv.c - Convert a valgrind lackey text trace into the compact
+ * binary trace format read by "csim -T bin" (see csim_trace.h).
+ *
+ * Lines that are not I/L/S/M records, such as the "==pid==" banner that
+ * valgrind prints around the trace, are dropped and counted.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include "csim_trace.h"
+
+/* Print help options */
+void usage(char *argv[])
+{
+    printf("Usage: %s [-h] -t <file> -o <file>\n", argv[0]);
+    printf("Options:\n");
+    printf("  -h         Print this help message.\n");
+    printf("  -t <file>  Lackey text trace to read.\n");
+    printf("  -o <file>  Binary trace to write.\n");
+    printf("\n");
+    printf("Example:\n");
+    printf("  linux>  %s -t traces/long.trace -o long.bin\n", argv[0]);
+    printf("  linux>  ./csim -s 5 -E 1 -b 5 -T bin -t long.bin\n");
+}
+
+int main(int argc, char *argv[])
+{
+    char *infile = NULL, *outfile = NULL;
+    char c;
+    while ((c = getopt(argc, argv, "ht:o:")) != -1) {
+        switch (c) {
+        case 't':
+            infile = optarg;
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        case 'h':
+            usage(argv);
+            exit(0);
+        default:
+            usage(argv);
+            exit(1);
+        }
+    }
+    if (NULL == infile || NULL == outfile) {
+        printf("Error: Missing required argument\n");
+        usage(argv);
+        exit(1);
+    }
+
+    trace_reader tr;
+    trace_bin_writer tw;
+    cache_opt co;
+    unsigned long long skipped = 0;
+    int ret;
+    if ((ret = trace_open(&tr, infile, TRACE_MMAP)) < 0) {
+        fprintf(stderr, "%s: %s\n", infile, trace_strerror(ret));
+        exit(1);
+    }
+    if (trace_bin_create(&tw, outfile) < 0) {
+        fprintf(stderr, "%s: Unable to create file\n", outfile);
+        exit(1);
+    }
+    while (trace_next(&tr, &co)) {
+        char op;
+        if ('I' == co.inst && ' ' == co.opttype) {
+            op = 'I';
+        } else if (' ' == co.inst) {
+            op = co.opttype; // trace_bin_put() rejects anything but L/S/M.
+        } else {
+            skipped++;
+            continue;
+        }
+        if (trace_bin_put(&tw, op, tr.lastaddr, co.size) < 0) {
+            if (ferror(tw.fp)) {
+                fprintf(stderr, "%s: Write error\n", outfile);
+                exit(1);
+            }
+            skipped++;
+        }
+    }
+    trace_close(&tr);
+    if (trace_bin_finish(&tw) < 0) {
+        fprintf(stderr, "%s: Write error\n", outfile);
+        exit(1);
+    }
+    printf("records:%llu skipped:%llu addrbits:%d\n", tw.nrecords, skipped, tw.addrbits);
+    return 0;
+}
@@ -4,7 +4,8 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use, and the extents of A
+ * and B in a region map for csim -r.
  */
 
 #include <stdlib.h>
@@ -83,6 +84,18 @@ int main(int argc, char* argv[]){
             (unsigned long long int) &MARKER_START,
             (unsigned long long int) &MARKER_END );
     fclose(marker_fp);
+    /* Record where A and B live, as the transpose functions index them */
+    FILE* region_fp = fopen(".regions","w");
+    assert(region_fp);
+    fprintf(region_fp, "A 0x%llx %lu\nB 0x%llx %lu\n",
+            (unsigned long long int) A, (unsigned long) (M * N * sizeof(int)),
+            (unsigned long long int) B, (unsigned long) (M * N * sizeof(int)));
+    fclose(region_fp);
+    /* ... and in the output, for readers of a live valgrind stream */
+    printf("marker %llx %llx\n",
+           (unsigned long long int) &MARKER_START,
+           (unsigned long long int) &MARKER_END );
+    fflush(stdout);
 
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */